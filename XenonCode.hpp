@@ -9,6 +9,8 @@
 #include <map>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
+#include <bit>
 #include <stack>
 #include <cassert>
 #include <algorithm>
@@ -17,6 +19,17 @@
 #include <functional>
 #include <cstring>
 #include <utility>
+#include <memory>
+#include <tuple>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <future>
+#include <exception>
+#include <cstddef>
 
 #ifndef XC_NAMESPACE
 	#define XC_NAMESPACE XenonCode
@@ -269,7 +282,7 @@ namespace XC_NAMESPACE {
 
 // Version
 const int VERSION_MAJOR = 0; // Requires assembly compiled with the same major version
-const int VERSION_MINOR = 1; // Requires assembly compiled with a version <= than interpreter's minor version
+const int VERSION_MINOR = 3; // Requires assembly compiled with a version <= than interpreter's minor version
 const int VERSION_PATCH = 0;
 
 #pragma region Limitations/Settings // these are default values, may be overridden by the implementation
@@ -313,6 +326,34 @@ const int VERSION_PATCH = 0;
 	#ifndef XC_RECURSIVE_MEMORY_PENALTY
 		#define XC_RECURSIVE_MEMORY_PENALTY 16
 	#endif
+	#ifndef XC_PARALLEL_PARSING
+		#define XC_PARALLEL_PARSING 1 // parse included files concurrently, and large files in parallel chunks
+	#endif
+	#ifndef XC_PARSE_CHUNK_LINES
+		#define XC_PARSE_CHUNK_LINES 2048 // min number of lines parsed by each thread within a single file
+	#endif
+	#ifndef XC_PARSING_THREADS
+		#define XC_PARSING_THREADS 0 // max number of threads parsing files at once besides the ones that compile, shared by all compilations (0 = one less than the hardware concurrency)
+	#endif
+	#ifndef XC_COMPILE_CACHE_MAX_ENTRIES
+		#define XC_COMPILE_CACHE_MAX_ENTRIES 1024 // max number of compiled programs kept in memory by the CompileCache
+	#endif
+	#ifndef XC_OPTIMIZATION_LEVEL
+		#define XC_OPTIMIZATION_LEVEL 0 // default bytecode optimization level of the compiler, opt in per compilation or by defining it (0 = none, 1 = folding, unreachable code and unused functions, variables and constants, 2 = also inlining, evaluation of calls with constant arguments, copy propagation, common subexpressions, loop invariants and dead stores)
+	#endif
+	#ifndef XC_INLINE_MAX_INSTRUCTIONS
+		#define XC_INLINE_MAX_INSTRUCTIONS 8 // max number of instructions of a user function for its calls to be inlined (at optimization level 2)
+	#endif
+	#ifndef XC_EVALUATE_MAX_INSTRUCTIONS
+		#define XC_EVALUATE_MAX_INSTRUCTIONS 10000 // max number of instructions run by the compiler to evaluate a call of a user function with constant arguments (at optimization level 2)
+	#endif
+	#ifndef XC_COMPUTED_GOTO
+		#if defined(__GNUC__) || defined(__clang__)
+			#define XC_COMPUTED_GOTO 1 // use labels-as-values dispatch in the interpreter loop
+		#else
+			#define XC_COMPUTED_GOTO 0 // fallback to the switch-based dispatch
+		#endif
+	#endif
 
 #pragma endregion
 
@@ -448,7 +489,15 @@ const int VERSION_PATCH = 0;
 		}
 		str.replace(i, j-i, substr);
 	}
-	
+
+	// 64-bit FNV-1a, may be chained by passing the previous hash
+	inline static uint64_t fnv1a64(std::string_view str, uint64_t hash = 14695981039346656037ull) {
+		for (unsigned char c : str) {
+			hash = (hash ^ c) * 1099511628211ull;
+		}
+		return hash;
+	}
+
 #pragma endregion
 
 #pragma region Errors
@@ -724,73 +773,92 @@ const int VERSION_PATCH = 0;
 			return *this;
 		}
 		
-		Word(std::istringstream& s) {
-			for (int c; int8_t(c = s.get()) != -1; ) if (c != ' ') {
+		// Reads the next word of the line s starting at pos, and advances pos past it
+		// Expressions are not copied: their contents (between the parenthesis) are set in expression, to be parsed in place
+		Word(std::string_view s, size_t& pos, std::string_view& expression) {
+			const size_t n = s.size();
+			auto peek = [&]() -> int { return pos < n? (unsigned char)s[pos] : EOF; };
+			auto readIdentifier = [&](size_t begin) {
+				while (pos < n && isalnum_((unsigned char)s[pos])) ++pos;
+				word.assign(s.data() + begin, pos - begin);
+				asciiToLower(word);
+			};
+			while (pos < n) {
+				const int c = (unsigned char)s[pos++];
+				if (c == 0xFF) { // end of stream
+					pos = n;
+					return;
+				}
+				if (c == ' ') continue;
 				switch (c) {
 					case '\t':{
-						word = c;
+						word = char(c);
 						type = Tab;
 					}return;
 					// Variables and Constants
 					case '$':{
-						if (isalpha_(s.peek())) {
-							do {
-								word += tolower(s.get());
-							} while (!s.eof() && isalnum_(s.peek()));
+						if (isalpha_(peek())) {
+							readIdentifier(pos);
 							type = Varname;
 						} else throw ParseError("Invalid var/const name");
 					}return;
 					// User-defined Functions
 					case '@':{
-						if (isalpha_(s.peek())) {
-							do {
-								word += tolower(s.get());
-							} while (!s.eof() && isalnum_(s.peek()));
+						if (isalpha_(peek())) {
+							readIdentifier(pos);
 							type = Funcname;
 						} else throw ParseError("Invalid function name");
 					}return;
-					// Text literals
+					// Text literals ("" is an escaped quote)
 					case '"':{
-						while (!s.eof()) {
-							if (s.peek() == '"') {
-								s.get();
-								if (s.eof() || s.peek() != '"') {
-									break;
-								}
+						for (;;) {
+							size_t end = s.find('"', pos);
+							if (end == std::string_view::npos) end = n;
+							if (word.length() + (end - pos) > XC_MAX_TEXT_LENGTH) {
+								throw ParseError("Text too long");
 							}
+							word.append(s.data() + pos, end - pos);
+							pos = end;
+							if (pos >= n) break;
+							++pos;
+							if (peek() != '"') break;
 							if (word.length() >= XC_MAX_TEXT_LENGTH) {
 								throw ParseError("Text too long");
 							}
-							word += s.get();
+							word += '"';
+							++pos;
 						}
 						type = Text;
 					}return;
 					// Expressions
 					case '(':{
+						const size_t begin = pos;
 						int stack = 0;
 						bool inString = false;
-						while (!s.eof()) {
+						while (pos < n) {
+							const char ch = s[pos];
 							if (inString) {
-								if (s.peek() == '"') {
-									word += s.get();
-									if (s.peek() != '"') {
+								if (ch == '"') {
+									++pos;
+									if (peek() != '"') {
 										inString = false;
 										continue;
 									}
 								}
 							} else {
-								if (s.peek() == '(') {
+								if (ch == '(') {
 									stack++;
-								} else if (s.peek() == ')') {
+								} else if (ch == ')') {
 									if (stack-- == 0) {
-										s.get();
+										expression = s.substr(begin, pos - begin);
+										++pos;
 										break;
 									}
-								} else if (s.peek() == '"') {
+								} else if (ch == '"') {
 									inString = true;
 								}
 							}
-							word += s.get();
+							++pos;
 						}
 						if (stack < -1) {
 							throw ParseError("Extra parenthesis");
@@ -805,57 +873,59 @@ const int VERSION_PATCH = 0;
 					}
 				}
 				// Comments
-				if (c == ';' || (c == '/' && s.peek() == '/')) {
-					s = {};
+				if (c == ';' || (c == '/' && peek() == '/')) {
+					pos = n;
 					return;
 				}
 				// HashTag
 				if (c == '#') {
-					word = c;
+					word = char(c);
 					type = HashTag;
 					return;
 				}
 				// Operators
 				if (isoperator(c)) {
-					word += c;
-					int c2 = s.peek();
+					word = char(c);
+					int c2 = peek();
 					if (isoperator(c2) && (c2 == c || c2 == '=' || (c == '<' && c2 == '>'))) {
-						word += s.get();
+						word += char(c2);
+						++pos;
 					}
 					type = Operator;
 					return;
 				}
 				// Numeric
 				if (isdigit(c)) {
-					word += c;
+					const size_t begin = pos - 1;
 					bool hasDecimal = false;
-					while (!s.eof()) {
-						if (s.peek() == '.') {
+					while (pos < n) {
+						if (peek() == '.') {
 							if (hasDecimal) break;
 							hasDecimal = true;
-							word += s.get();
+							++pos;
 						}
-						if (!isdigit(s.peek())) {
-							if (!hasDecimal && isalnum_(s.peek())) goto ContinueWithName;
+						if (!isdigit(peek())) {
+							if (!hasDecimal && isalnum_(peek())) {
+								readIdentifier(begin);
+								type = Name;
+								return;
+							}
 							else break;
 						}
-						word += s.get();
+						++pos;
 					}
+					word.assign(s.data() + begin, pos - begin);
 					type = Numeric;
 					return;
 				}
 				// Name
 				if (isalpha_(c)) {
-					word += tolower(c);
-					ContinueWithName:
-					while (isalnum_(s.peek())) {
-						word += tolower(s.get());
-					}
+					readIdentifier(pos - 1);
 					type = Name;
 					return;
 				}
 				// Invalid
-				word = c;
+				word = char(c);
 				type = Invalid;
 				return;
 			}
@@ -867,9 +937,10 @@ const int VERSION_PATCH = 0;
 	}
 
 	// Parses one or more words from given string (including expressions done recursively), and assign final types to words. Sets resulting words in given words ref. This will NOT add expressions according to operator precedence. 
-	inline static void ParseWords(const std::string& str, std::vector<Word>& words, int& scope) {
-		std::istringstream line(str);
-		while (Word word {line}) {
+	inline static void ParseWords(std::string_view str, std::vector<Word>& words, int& scope) {
+		size_t pos = 0;
+		std::string_view expression {};
+		while (Word word {str, pos, expression}) {
 			if (word == Word::Tab) {
 				if (words.size() == 0) {
 					++scope;
@@ -919,12 +990,12 @@ const int VERSION_PATCH = 0;
 				}
 				if (word == Word::Expression) {
 					words.push_back(Word::ExpressionBegin);
-					ParseWords(word, words, scope);
+					ParseWords(expression, words, scope);
 					words.push_back(Word::ExpressionEnd);
 				} else if (word == Word::HashTag) {
 					return; // ignore the remaining of the line
 				} else {
-					words.push_back(word);
+					words.push_back(std::move(word));
 				}
 			}
 		}
@@ -1263,7 +1334,7 @@ const int VERSION_PATCH = 0;
 		}
 		
 		// Key can be followed by any from set
-		const std::map<Word::Type, std::set<Word::Type>> authorizedSemantics {
+		static const std::map<Word::Type, std::set<Word::Type>> authorizedSemantics {
 			{Word::Numeric, {
 				Word::ExpressionEnd,
 				Word::CastOperator,
@@ -1436,7 +1507,7 @@ const int VERSION_PATCH = 0;
 		};
 		
 		// Left Key can be followed by any from set if preceeded by Right key (may have multiple sets per left key with different right keys)
-		const std::map<Word::Type, std::map<Word::Type, std::set<Word::Type>>> authorizedSemanticsWhenPreceeded {
+		static const std::map<Word::Type, std::map<Word::Type, std::set<Word::Type>>> authorizedSemanticsWhenPreceeded {
 			{Word::Name, {{Word::CastOperator, {
 				Word::ConcatOperator,
 				Word::ExpressionEnd,
@@ -1573,11 +1644,10 @@ const int VERSION_PATCH = 0;
 		"recursive",
 	};
 	
-	struct Implementation {
-		static std::unordered_map<std::string, double> globalNumericConstants;
-		static std::unordered_map<std::string, std::string> globalTextConstants;
-		static std::vector<std::string> entryPoints;
-	};
+	// Declarations of the implementation (constants, entry points, device functions and object types), see DeviceContext
+	struct DeviceContext;
+	DeviceContext& GetDefaultDeviceContext();
+	inline static bool IsDeclaredEntryPoint(const DeviceContext& context, const std::string& name);
 
 	// Valid first words for the possible statements in a function scope
 	static const std::vector<std::string> functionScopeFirstWords {
@@ -1606,14 +1676,14 @@ const int VERSION_PATCH = 0;
 			return words.size() > 0;
 		}
 		
-		ParsedLine(const std::string& str, int line_ = 0, bool generic = false) : line(line_) {
+		ParsedLine(std::string_view str, int line_ = 0, bool generic = false, const DeviceContext& context = GetDefaultDeviceContext()) : line(line_) {
 			ParseWords(str, words, scope);
 			
 			if (words.size() > 0) {
 				
 				// Check first word validity for this Scope
 				if (scope == 0) { // Global scope
-					if (words[0] != Word::Name || (!generic && find(begin(globalScopeFirstWords), end(globalScopeFirstWords), words[0].word) == end(globalScopeFirstWords) && find(begin(Implementation::entryPoints), end(Implementation::entryPoints), words[0].word) == end(Implementation::entryPoints))) {
+					if (words[0] != Word::Name || (!generic && find(begin(globalScopeFirstWords), end(globalScopeFirstWords), words[0].word) == end(globalScopeFirstWords) && !IsDeclaredEntryPoint(context, words[0].word))) {
 						throw ParseError("Invalid first word", words[0], "in the global scope");
 					}
 				} else { // Function scope
@@ -1777,7 +1847,7 @@ const int VERSION_PATCH = 0;
 						} else
 						
 					// entry points
-						if (generic || find(begin(Implementation::entryPoints), end(Implementation::entryPoints), words[0].word) != end(Implementation::entryPoints)) {
+						if (generic || IsDeclaredEntryPoint(context, words[0].word)) {
 							if (words.size() > 1) {
 								if (words[1] == Word::TrailOperator) {
 									if (words.size() > 2 && words[2] != Word::Numeric && words[2] != Word::Text && words[2] != Word::Varname) {
@@ -2085,37 +2155,137 @@ const int VERSION_PATCH = 0;
 		}
 	};
 
+	// Threads started to parse files, so that concurrent compilations with many included files and large files do not oversubscribe the machine (see XC_PARSING_THREADS)
+	class ParsingThreads {
+		inline static std::atomic<uint32_t> running = 0;
+	public:
+		// Reserves a thread, false when they are all busy, the calling thread then does the work itself
+		static bool TryAcquire() {
+			static const uint32_t max = XC_PARSING_THREADS > 0? XC_PARSING_THREADS : std::max(1u, std::thread::hardware_concurrency()) - 1;
+			uint32_t count = running.load();
+			while (count < max) {
+				if (running.compare_exchange_weak(count, count + 1)) return true;
+			}
+			return false;
+		}
+		static void Release() {
+			running.fetch_sub(1);
+		}
+		static uint32_t Running() {
+			return running.load();
+		}
+	};
+
 	// Upon construction, it will parse all lines from the given stream, and may throw ParseError
 	struct SourceFile {
 		std::string filepath;
 		std::vector<ParsedLine> lines;
 
-		SourceFile(const std::string& filepath_) : filepath(filepath_) {
+		SourceFile(const std::string& filepath_, const DeviceContext& context = GetDefaultDeviceContext()) : filepath(filepath_) {
 			std::ifstream stream{filepath};
 			
 			if (stream.fail()) {
 				throw ParseError("File not found '" + filepath + "'");
 			}
 			
+			Parse(stream, context);
+		}
+		
+		// From already parsed lines
+		SourceFile(const std::string& filepath_, std::vector<ParsedLine>&& lines_) : filepath(filepath_), lines(std::move(lines_)) {}
+		
+		// From the contents of the file at the given path
+		SourceFile(const std::string& filepath_, std::istream& stream, const DeviceContext& context = GetDefaultDeviceContext()) : filepath(filepath_) {
+			Parse(stream, context);
+		}
+		
+		void Parse(std::istream& stream, const DeviceContext& context) {
+			Parse(std::string{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()}, context);
+		}
+		
+		// From the contents of the file, lines are parsed in place
+		void Parse(std::string_view buffer, const DeviceContext& context) {
+			std::vector<std::string_view> lineStrs;
+			for (size_t begin = 0; begin < buffer.size();) {
+				size_t end = buffer.find('\n', begin);
+				if (end == std::string::npos) end = buffer.size();
+				std::string_view lineStr(buffer.data() + begin, end - begin);
+				// Remove trailing carriage return for Windows (CRLF) line endings compatibility
+				if (!lineStr.empty() && lineStr.back() == '\r') {
+					lineStr.remove_suffix(1);
+				}
+				lineStrs.push_back(lineStr);
+				begin = end + 1;
+			}
+			
+			lines.reserve(lineStrs.size() + 1);
 			lines.emplace_back(Word{Word::FileInfo, filepath});
 			
-			int lineNumber = 1;
-			int scope = 0;
+			// Each line is parsed independently, large files are split into chunks parsed in parallel
+			struct Chunk {
+				size_t begin, end;
+				std::vector<ParsedLine> lines {};
+				int errorLine = 0;
+				std::string error = "";
+				std::exception_ptr exception = nullptr; // any other exception
+				void Parse(const std::vector<std::string_view>& lineStrs, const DeviceContext& context) {
+					lines.reserve(end - begin);
+					for (size_t i = begin; i < end; ++i) {
+						try {
+							lines.emplace_back(lineStrs[i], int(i + 1), false, context);
+						} catch (ParseError& e) {
+							errorLine = int(i + 1);
+							error = e.what();
+							return;
+						} catch (...) {
+							errorLine = int(i + 1);
+							exception = std::current_exception();
+							return;
+						}
+					}
+				}
+			};
+			size_t nbChunks = 1;
+			#if XC_PARALLEL_PARSING
+				if (XC_PARSE_CHUNK_LINES > 0) {
+					nbChunks = std::clamp<size_t>(lineStrs.size() / std::max<size_t>(XC_PARSE_CHUNK_LINES, 1), 1, std::max(1u, std::thread::hardware_concurrency()));
+				}
+			#endif
+			std::vector<Chunk> chunks;
+			for (size_t i = 0; i < nbChunks; ++i) {
+				chunks.push_back({lineStrs.size() * i / nbChunks, lineStrs.size() * (i + 1) / nbChunks});
+			}
+			// The chunks that do not get a thread are parsed by this one
+			std::vector<std::thread> threads;
+			std::vector<size_t> inlineChunks {0};
+			for (size_t i = 1; i < nbChunks; ++i) {
+				if (ParsingThreads::TryAcquire()) {
+					threads.emplace_back([&, i]{
+						chunks[i].Parse(lineStrs, context);
+						ParsingThreads::Release();
+					});
+				} else {
+					inlineChunks.push_back(i);
+				}
+			}
+			for (size_t i : inlineChunks) {
+				chunks[i].Parse(lineStrs, context);
+			}
+			for (auto& thread : threads) {
+				thread.join();
+			}
 			
-			// Parse all lines
-			for (std::string lineStr; getline(stream, lineStr); lineNumber++) {
-				// Remove trailing carriage return for Windows (CRLF) line endings compatibility
-				if (!lineStr.empty() && lineStr.back() == '\r') {
-					lineStr.pop_back();
+			// Merge in order, the first error of the file is reported
+			for (auto& chunk : chunks) {
+				if (chunk.exception) {
+					std::rethrow_exception(chunk.exception);
 				}
-				try {
-					auto& line = lines.emplace_back(lineStr, lineNumber);
-					scope = line.scope;
-				} catch (ParseError& e) {
+				if (chunk.errorLine) {
 					std::stringstream err {};
-					err << e.what() << " in " << filepath << ":" << lineNumber;
+					err << chunk.error << " in " << filepath << ":" << chunk.errorLine;
 					throw ParseError(err.str());
 				}
+				std::move(chunk.lines.begin(), chunk.lines.end(), std::back_inserter(lines));
 			}
 		}
 		
@@ -2136,7 +2306,7 @@ const int VERSION_PATCH = 0;
 			return filepath.string();
 		}
 		
-		SourceFile(const std::string& filedir, const std::string& filename) : SourceFile(GetExistingFilePath(filedir, filename)) {}
+		SourceFile(const std::string& filedir, const std::string& filename, const DeviceContext& context = GetDefaultDeviceContext()) : SourceFile(GetExistingFilePath(filedir, filename), context) {}
 		
 		void DebugParsedLines() {
 			for (auto& line : lines) {
@@ -2150,36 +2320,190 @@ const int VERSION_PATCH = 0;
 		}
 	};
 
-	// This function recursively parses the given file and all included files and returns all lines joined
-	inline static SourceFile GetParsedFile(const std::string& filedir, const std::string& filename, std::set<std::string>& parsedFiles) {
+	// Appends the lines of the given parsed file to output, replacing the include statements by the lines of the included files, recursively
+	// getFile(filedir, filename) returns the parsed file (std::shared_ptr<const SourceFile>)
+	template<typename GetFile>
+	inline static void AppendParsedFile(const std::string& filedir, const std::string& filename, std::set<std::string>& parsedFiles, std::vector<ParsedLine>& output, GetFile&& getFile) {
 		std::string filenameLC = filename;
 		std::transform(filenameLC.begin(), filenameLC.end(), filenameLC.begin(), ::tolower);
 		if (parsedFiles.contains(filenameLC)) {
 			throw ParseError("Circular dependency detected with file '" + filename + "'");
 		}
 		parsedFiles.insert(filenameLC);
-		SourceFile src(filedir, filename);
-		// Include other files (and replace the include statement by the lines of the other file, recursively)
-		for (unsigned int i = 0; i < src.lines.size(); ++i) {
-			if (auto& line = src.lines[i]; line) {
-				if (line.scope == 0 && line.words[0] == "include") {
-					std::string includeFilename = line.words[1];
-					line.words.clear();
-					auto includeSrc = GetParsedFile(filedir, includeFilename, parsedFiles);
-					src.lines.insert(src.lines.begin()+i, includeSrc.lines.begin(), includeSrc.lines.end());
-					i += includeSrc.lines.size();
-					src.lines.insert(src.lines.begin()+i, Word{Word::FileInfo, filedir + "/" + filename});
-					++i;
-				}
-			}
-		}
-		return src;
+		const auto src = getFile(filedir, filename);
+		output.reserve(output.size() + src->lines.size());
+		for (const auto& line : src->lines) {
+			if (line && line.scope == 0 && line.words[0] == "include") {
+				std::string includeFilename = line.words[1];
+				AppendParsedFile(filedir, includeFilename, parsedFiles, output, getFile);
+				output.emplace_back(Word{Word::FileInfo, filedir + "/" + filename});
+				output.emplace_back(line).words.clear();
+			} else {
+				output.emplace_back(line);
+			}
+		}
+	}
+
+	// Parses all the files of an include tree concurrently, each file starts parsing as soon as the file that includes it is parsed
+	// Get() waits for the given file, errors are rethrown there so they are reported in the same order as when parsing sequentially
+	// Files that do not get a thread (see ParsingThreads) are parsed by the first Get() that needs them
+	template<typename GetFile>
+	class ParsedFilesPrefetch {
+		GetFile getFile;
+		std::mutex mutex {};
+		std::unordered_map<std::string/*lowercase filename*/, std::shared_future<std::shared_ptr<const SourceFile>>> files {};
+		
+	public:
+		ParsedFilesPrefetch(GetFile&& getFile_) : getFile(std::forward<GetFile>(getFile_)) {}
+		ParsedFilesPrefetch(const ParsedFilesPrefetch&) = delete;
+		ParsedFilesPrefetch& operator=(const ParsedFilesPrefetch&) = delete;
+		~ParsedFilesPrefetch() {
+			// Wait for the files still parsing (after an error)
+			std::vector<std::shared_future<std::shared_ptr<const SourceFile>>> pending;
+			{
+				std::lock_guard lock(mutex);
+				for (auto& [name, file] : files) pending.push_back(file);
+			}
+			for (auto& file : pending) {
+				if (file.wait_for(std::chrono::seconds(0)) != std::future_status::deferred) file.wait();
+			}
+		}
+		
+		void Schedule(const std::string& filedir, const std::string& filename) {
+			std::string filenameLC = filename;
+			strtolower(filenameLC);
+			std::lock_guard lock(mutex);
+			if (files.contains(filenameLC)) return;
+			const bool async = ParsingThreads::TryAcquire();
+			files.emplace(filenameLC, std::async(async? std::launch::async : std::launch::deferred, [this, filedir, filename, async]{
+				struct Release {
+					bool async;
+					~Release() {if (async) ParsingThreads::Release();}
+				} release {async};
+				std::shared_ptr<const SourceFile> src = getFile(filedir, filename);
+				for (const auto& line : src->lines) {
+					if (line && line.scope == 0 && line.words[0] == "include") {
+						Schedule(filedir, line.words[1]);
+					}
+				}
+				return src;
+			}).share());
+		}
+		
+		std::shared_ptr<const SourceFile> Get(const std::string& filedir, const std::string& filename) {
+			std::string filenameLC = filename;
+			strtolower(filenameLC);
+			std::shared_future<std::shared_ptr<const SourceFile>> file;
+			{
+				std::lock_guard lock(mutex);
+				auto it = files.find(filenameLC);
+				if (it == files.end()) {
+					return getFile(filedir, filename);
+				}
+				file = it->second;
+			}
+			return file.get();
+		}
+	};
+
+	// Recursively parses the given file and all included files (with the given getFile, see AppendParsedFile) and returns all lines joined
+	template<typename GetFile>
+	inline static std::vector<ParsedLine> GetParsedLines(const std::string& filedir, const std::string& filename, std::set<std::string>& parsedFiles, GetFile&& getFile) {
+		std::vector<ParsedLine> lines;
+		#if XC_PARALLEL_PARSING
+			ParsedFilesPrefetch<GetFile> prefetch(std::forward<GetFile>(getFile));
+			prefetch.Schedule(filedir, filename);
+			AppendParsedFile(filedir, filename, parsedFiles, lines, [&](const std::string& dir, const std::string& name){
+				return prefetch.Get(dir, name);
+			});
+		#else
+			AppendParsedFile(filedir, filename, parsedFiles, lines, getFile);
+		#endif
+		return lines;
+	}
+
+	// This function recursively parses the given file and all included files and returns all lines joined
+	inline static SourceFile GetParsedFile(const std::string& filedir, const std::string& filename, std::set<std::string>& parsedFiles, const DeviceContext& context = GetDefaultDeviceContext()) {
+		std::vector<ParsedLine> lines = GetParsedLines(filedir, filename, parsedFiles, [&context](const std::string& dir, const std::string& name){
+			return std::make_shared<const SourceFile>(dir, name, context);
+		});
+		return SourceFile(SourceFile::GetExistingFilePath(filedir, filename), std::move(lines));
 	}
-	inline static SourceFile GetParsedFile(const std::string& filedir, const std::string& filename) {
+	inline static SourceFile GetParsedFile(const std::string& filedir, const std::string& filename, const DeviceContext& context = GetDefaultDeviceContext()) {
 		std::set<std::string> parsedFiles;
-		return GetParsedFile(filedir, filename, parsedFiles);
+		return GetParsedFile(filedir, filename, parsedFiles, context);
 	}
 
+	// Keeps the parsed files between compilations of the same program, only the files that changed since the last call are parsed again
+	// A file is considered unchanged when its modification time and size are the same, or its contents hash to the same value
+	// GetParsedFile must not be called concurrently on the same session, use one session per program being edited
+	class CompileSession {
+		struct CachedFile {
+			std::filesystem::file_time_type time {};
+			uintmax_t size = 0;
+			uint64_t hash = 0;
+			std::shared_ptr<const SourceFile> src {};
+		};
+		const DeviceContext* context;
+		std::mutex mutex {}; // included files are parsed concurrently
+		std::unordered_map<std::string/*filepath*/, CachedFile> files {};
+		std::set<std::string> usedFiles {}; // files used by the last call to GetParsedFile
+
+		std::shared_ptr<const SourceFile> GetFile(const std::string& filedir, const std::string& filename) {
+			std::string filepath = SourceFile::GetExistingFilePath(filedir, filename);
+			std::error_code err;
+			auto time = std::filesystem::last_write_time(filepath, err);
+			auto size = std::filesystem::file_size(filepath, err);
+			CachedFile cached {};
+			{
+				std::lock_guard lock(mutex);
+				usedFiles.insert(filepath);
+				if (auto it = files.find(filepath); it != files.end()) {
+					if (!err && it->second.time == time && it->second.size == size) {
+						return it->second.src;
+					}
+					cached = it->second;
+				}
+			}
+			std::ifstream stream{filepath, std::ios::binary};
+			if (stream.fail()) {
+				throw ParseError("File not found '" + filepath + "'");
+			}
+			std::string contents {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+			uint64_t hash = fnv1a64(contents);
+			if (!cached.src || cached.hash != hash) {
+				auto src = std::make_shared<SourceFile>(filepath, std::vector<ParsedLine>{});
+				src->Parse(contents, *context);
+				cached.src = std::move(src);
+				cached.hash = hash;
+			}
+			cached.time = time;
+			cached.size = size;
+			std::lock_guard lock(mutex);
+			files[filepath] = cached;
+			return cached.src;
+		}
+
+	public:
+		explicit CompileSession(const DeviceContext& context_ = GetDefaultDeviceContext()) : context(&context_) {}
+
+		// Same as the free function GetParsedFile, files removed from the include tree are forgotten
+		SourceFile GetParsedFile(const std::string& filedir, const std::string& filename) {
+			std::set<std::string> parsedFiles;
+			usedFiles.clear();
+			std::vector<ParsedLine> lines = GetParsedLines(filedir, filename, parsedFiles, [this](const std::string& dir, const std::string& name){
+				return GetFile(dir, name);
+			});
+			std::erase_if(files, [this](const auto& file){ return !usedFiles.contains(file.first); });
+			return SourceFile(SourceFile::GetExistingFilePath(filedir, filename), std::move(lines));
+		}
+
+		// Number of parsed files kept in this session
+		size_t Size() const {
+			return files.size();
+		}
+	};
+
 #pragma endregion
 
 #pragma region Assembly Definition
@@ -2191,7 +2515,7 @@ const int VERSION_PATCH = 0;
 		DISCARD = 11, // Discard the return value of this statement
 		OP = 32, // OP [...] VOID
 		
-		// Comments/Info
+		// Comments/Info (only found in assemblies compiled before version 0.2, now stored in DebugInfo instead)
 		SOURCEFILE = 33,
 		LINENUMBER = 34,
 
@@ -2301,6 +2625,80 @@ const int VERSION_PATCH = 0;
 	DEF_OP( IFF /* REF_DST REF_TXT */ ) // if(cond, valTrue, valFalse)
 	DEF_OP( RPL /* REF_DST REF_TXT */ ) // replace(text, oldValue, newValue, [count])
 
+	// All of the above, in the same order. Used for generating the interpreter's dense opcode indices and dispatch table.
+	#define XC_OPCODE_LIST(X) \
+		X(SET) X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) X(POW) X(CCT) X(AND) X(ORR) X(XOR) X(EQQ) X(NEQ) X(LST) X(GRT) X(LTE) X(GTE) \
+		X(INC) X(DEC) X(NOT) X(FLR) X(CIL) X(RND) X(SIN) X(COS) X(TAN) X(ASI) X(ACO) X(ATA) X(ABS) X(FRA) X(SQR) X(SIG) \
+		X(LOG) X(CLP) X(STP) X(SMT) X(LRP) X(NUM) X(TXT) X(DEV) X(OUT) X(APP) X(CLR) X(POP) X(ASC) X(DSC) X(INS) X(DEL) \
+		X(FLL) X(FRM) X(SIZ) X(LAS) X(FND) X(CON) X(MIN) X(MAX) X(AVG) X(SUM) X(MED) X(SBS) X(IDX) X(JMP) X(GTO) X(CND) \
+		X(KEY) X(STR) X(RST) X(HSH) X(UPP) X(LCC) X(ISN) X(IFF) X(RPL)
+	
+	// Type-specialized variants of the most common numeric operations, selected by Assembly::Predecode when all operands are plain numeric references.
+	// R = RAM_VAR_NUMERIC, C = ROM_CONST_NUMERIC, in the order of the operands (REF_DST first). They must always be followed by a VOID.
+	// Binary variants must keep the RRR RRC RCR RCC order.
+	#define XC_QUICKENED_OPCODE_LIST(X) \
+		X(SET_RR) X(SET_RC) X(INC_R) X(DEC_R) \
+		X(ADD_RRR) X(ADD_RRC) X(ADD_RCR) X(ADD_RCC) \
+		X(SUB_RRR) X(SUB_RRC) X(SUB_RCR) X(SUB_RCC) \
+		X(MUL_RRR) X(MUL_RRC) X(MUL_RCR) X(MUL_RCC) \
+		X(DIV_RRR) X(DIV_RRC) X(DIV_RCR) X(DIV_RCC) \
+		X(EQQ_RRR) X(EQQ_RRC) X(EQQ_RCR) X(EQQ_RCC) \
+		X(NEQ_RRR) X(NEQ_RRC) X(NEQ_RCR) X(NEQ_RCC) \
+		X(LST_RRR) X(LST_RRC) X(LST_RCR) X(LST_RCC) \
+		X(GRT_RRR) X(GRT_RRC) X(GRT_RCR) X(GRT_RCC) \
+		X(LTE_RRR) X(LTE_RRC) X(LTE_RCR) X(LTE_RCC) \
+		X(GTE_RRR) X(GTE_RRC) X(GTE_RCR) X(GTE_RCC)
+	
+	// Superinstructions, selected by Assembly::Predecode for hot pairs of consecutive statements, each part is still charged as one instruction.
+	// CMP_*_CND: a quickened comparison immediately followed by a CND on its result (same operand order as above)
+	// GTO_INC_R: a GTO to a quickened INC, typically the back edge of a loop
+	// IDX_ADD_RRR: a numeric array read into a RAM var immediately followed by a quickened ADD_RRR
+	#define XC_SUPERINSTRUCTION_OPCODE_LIST(X) \
+		X(EQQ_RRR_CND) X(EQQ_RRC_CND) X(EQQ_RCR_CND) X(EQQ_RCC_CND) \
+		X(NEQ_RRR_CND) X(NEQ_RRC_CND) X(NEQ_RCR_CND) X(NEQ_RCC_CND) \
+		X(LST_RRR_CND) X(LST_RRC_CND) X(LST_RCR_CND) X(LST_RCC_CND) \
+		X(GRT_RRR_CND) X(GRT_RRC_CND) X(GRT_RCR_CND) X(GRT_RCC_CND) \
+		X(LTE_RRR_CND) X(LTE_RRC_CND) X(LTE_RCR_CND) X(LTE_RCC_CND) \
+		X(GTE_RRR_CND) X(GTE_RRC_CND) X(GTE_RCR_CND) X(GTE_RCC_CND) \
+		X(GTO_INC_R) X(IDX_ADD_RRR)
+	
+	// Accesses of a RAM numeric array indexed by a RAM var without bounds check, selected by Assembly::FindIndexedLoops when the index is proven to be within the array.
+	// IDX_UNCHECKED: REF_DST REF_ARR ARRAY_INDEX REF_NUM, SET_UNCHECKED_*: ARRAY_INDEX REF_NUM REF_ARR REF_VALUE (R or C), IDX_UNCHECKED_ADD_RRR: same as IDX_ADD_RRR
+	#define XC_UNCHECKED_OPCODE_LIST(X) \
+		X(IDX_UNCHECKED) X(SET_UNCHECKED_R) X(SET_UNCHECKED_C) X(IDX_UNCHECKED_ADD_RRR)
+	
+	// Dense opcode indices, resolved once per bytecode word when a program is loaded (never serialized)
+	enum OPCODE_INDEX : uint8_t {
+		OPCODE_INDEX_CORRUPTED = 0, // anything that is not a valid statement
+		OPCODE_INDEX_RETURN,
+		OPCODE_INDEX_VOID,
+		OPCODE_INDEX_UNKNOWN, // OP with an unknown opcode, ignored by the interpreter
+		#define XC_OPCODE_INDEX(op) OPCODE_INDEX_##op,
+		XC_OPCODE_LIST(XC_OPCODE_INDEX)
+		XC_QUICKENED_OPCODE_LIST(XC_OPCODE_INDEX)
+		XC_SUPERINSTRUCTION_OPCODE_LIST(XC_OPCODE_INDEX)
+		XC_UNCHECKED_OPCODE_LIST(XC_OPCODE_INDEX)
+		#undef XC_OPCODE_INDEX
+		OPCODE_INDEX_COUNT
+	};
+	static_assert(OPCODE_INDEX_COUNT <= 256);
+	
+	inline static constexpr uint8_t GetOpcodeIndex(uint32_t rawValue) {
+		switch (rawValue >> 24) {
+			case RETURN: return OPCODE_INDEX_RETURN;
+			case VOID: return OPCODE_INDEX_VOID;
+			case SOURCEFILE: return OPCODE_INDEX_VOID; // legacy debug info, see DebugInfo
+			case LINENUMBER: return OPCODE_INDEX_VOID; // legacy debug info, see DebugInfo
+			case OP: switch (rawValue) {
+				#define XC_OPCODE_INDEX(op) case op: return OPCODE_INDEX_##op;
+				XC_OPCODE_LIST(XC_OPCODE_INDEX)
+				#undef XC_OPCODE_INDEX
+				default: return OPCODE_INDEX_UNKNOWN;
+			}
+			default: return OPCODE_INDEX_CORRUPTED;
+		}
+	}
+
 #pragma endregion
 
 #pragma region Compiler
@@ -2311,112 +2709,190 @@ const int VERSION_PATCH = 0;
 			Numeric = 1,
 			Text = 2,
 			Object = 128
-		} type;
+		};
+		
+		// Texts of up to INLINE_TEXT_CAPACITY bytes are stored inline (textInline continued by the union below), longer texts are shared between copies of the Var
+		static constexpr uint8_t INLINE_TEXT_CAPACITY = 14;
+		static constexpr uint8_t SHARED_TEXT = 0xFF;
+		struct SharedText {
+			std::atomic<uint32_t> refs {1};
+			std::string value;
+			SharedText(std::string&& value_) : value(std::move(value_)) {}
+		};
 		
-		std::string textValue;
+		Type type;
+		uint8_t textSize = 0; // size of an inline text, or SHARED_TEXT
+		char textInline[6] {};
 		union {
 			double numericValue;
 			uint64_t addrValue;
+			SharedText* textShared;
 		};
 		
-		Var() : type(Void), textValue(""), numericValue(0.0) {}
-		Var(bool value) : type(Numeric), textValue(""), numericValue(value) {}
-		Var(int32_t value) : type(Numeric), textValue(""), numericValue(value) {}
-		Var(int64_t value) : type(Numeric), textValue(""), numericValue(value) {}
-		Var(uint32_t value) : type(Numeric), textValue(""), numericValue(value) {}
-		Var(uint64_t value) : type(Numeric), textValue(""), numericValue(value) {}
-		Var(double value) : type(Numeric), textValue(""), numericValue(value) {}
-		Var(float value) : type(Numeric), textValue(""), numericValue(value) {}
-		Var(const char* value) : type(Text), textValue(value), numericValue(0) {}
-		Var(const std::string& value) : type(Text), textValue(value), numericValue(0) {}
-		Var(const Var& other) : type(other.type), textValue(other.textValue), numericValue(other.numericValue) {}
+		Var() : type(Void), numericValue(0.0) {}
+		Var(bool value) : type(Numeric), numericValue(value) {}
+		Var(int32_t value) : type(Numeric), numericValue(value) {}
+		Var(int64_t value) : type(Numeric), numericValue(value) {}
+		Var(uint32_t value) : type(Numeric), numericValue(value) {}
+		Var(uint64_t value) : type(Numeric), numericValue(value) {}
+		Var(double value) : type(Numeric), numericValue(value) {}
+		Var(float value) : type(Numeric), numericValue(value) {}
+		Var(const char* value) : type(Text) { SetText(value); }
+		Var(std::string_view value) : type(Text) { SetText(value); }
+		Var(const std::string& value) : type(Text) { SetText(value); }
+		Var(std::string&& value) : type(Text) { SetText(std::move(value)); }
+		Var(Type type_, uint64_t objAddr) : type(type_), addrValue(objAddr) {}
+		Var(const Var& other) {
+			CopyFrom(other);
+			Retain();
+		}
+		Var(Var&& other) noexcept {
+			CopyFrom(other);
+			other.type = Void;
+		}
 		Var& operator=(const Var& other) {
 			if (this == &other) return *this;
-			type = other.type;
-			textValue = other.textValue;
-			numericValue = other.numericValue;
+			other.Retain();
+			Release();
+			CopyFrom(other);
+			return *this;
+		}
+		Var& operator=(Var&& other) noexcept {
+			if (this == &other) return *this;
+			Release();
+			CopyFrom(other);
+			other.type = Void;
 			return *this;
 		}
-		Var(Type type_, uint64_t objAddr) : type(type_), textValue(""), addrValue(objAddr) {}
+		~Var() {
+			Release();
+		}
+		
+		// Empty if this is not a Text, valid as long as this Var is not modified
+		std::string_view GetText() const {
+			if (type != Text) return {};
+			if (textSize == SHARED_TEXT) return textShared->value;
+			return {reinterpret_cast<const char*>(this) + offsetof(Var, textInline), textSize};
+		}
 		
 		operator bool() const {
 			if (type == Numeric) return numericValue;
-			if (type == Text) return textValue != "";
+			if (type == Text) return !GetText().empty();
 			if (type >= Object) return addrValue;
 			return false;
 		}
 		operator double() const {
 			if (type == Numeric) return numericValue;
-			else if (type == Text) return ToDouble(textValue);
+			else if (type == Text) return ToDouble(std::string(GetText()));
 			return 0.0;
 		}
 		operator float() const {
 			if (type == Numeric) return float(numericValue);
-			else if (type == Text) return ToFloat(textValue);
+			else if (type == Text) return ToFloat(std::string(GetText()));
 			return 0.0f;
 		}
 		operator int64_t() const {
 			if (type == Numeric) return (int64_t)std::round(numericValue);
-			else if (type == Text) return stoll(textValue);
+			else if (type == Text) return stoll(std::string(GetText()));
 			return 0;
 		}
 		operator uint64_t() const {
 			if (type == Numeric) return (uint64_t)std::round(numericValue);
-			else if (type == Text) return stoull(textValue);
+			else if (type == Text) return stoull(std::string(GetText()));
 			else if (type >= Object) return addrValue;
 			return 0;
 		}
 		operator int32_t() const {
 			if (type == Numeric) return (int32_t)std::round(numericValue);
-			else if (type == Text) return stol(textValue);
+			else if (type == Text) return stol(std::string(GetText()));
 			return 0;
 		}
 		operator uint32_t() const {
 			if (type == Numeric) return (uint32_t)std::round(numericValue);
-			else if (type == Text) return stoul(textValue);
+			else if (type == Text) return stoul(std::string(GetText()));
 			return 0;
 		}
 		operator int16_t() const {
 			if (type == Numeric) return (int16_t)std::round(numericValue);
-			else if (type == Text) return stol(textValue);
+			else if (type == Text) return stol(std::string(GetText()));
 			return 0;
 		}
 		operator uint16_t() const {
 			if (type == Numeric) return (uint16_t)std::round(numericValue);
-			else if (type == Text) return stoul(textValue);
+			else if (type == Text) return stoul(std::string(GetText()));
 			return 0;
 		}
 		operator int8_t() const {
 			if (type == Numeric) return (int8_t)std::round(numericValue);
-			else if (type == Text) return stol(textValue);
+			else if (type == Text) return stol(std::string(GetText()));
 			return 0;
 		}
 		operator uint8_t() const {
 			if (type == Numeric) return (uint8_t)std::round(numericValue);
-			else if (type == Text) return stoul(textValue);
+			else if (type == Text) return stoul(std::string(GetText()));
 			return 0;
 		}
 		operator std::string() const {
 			if (type == Numeric) return ToString(numericValue);
-			else if (type == Text) return textValue;
+			else if (type == Text) return std::string(GetText());
 			return "";
 		}
+		
+	private:
+		template<typename S>
+		void SetText(S&& value) {
+			std::string_view view {value};
+			if (view.size() <= INLINE_TEXT_CAPACITY) {
+				textSize = uint8_t(view.size());
+				std::memcpy(reinterpret_cast<char*>(this) + offsetof(Var, textInline), view.data(), view.size());
+			} else {
+				textSize = SHARED_TEXT;
+				textShared = new SharedText(std::string(std::forward<S>(value)));
+			}
+		}
+		void CopyFrom(const Var& other) noexcept {
+			type = other.type;
+			textSize = other.textSize;
+			std::memcpy(textInline, other.textInline, sizeof(textInline));
+			addrValue = other.addrValue;
+		}
+		void Retain() const noexcept {
+			if (type == Text && textSize == SHARED_TEXT) {
+				textShared->refs.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		void Release() noexcept {
+			if (type == Text && textSize == SHARED_TEXT && textShared->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				delete textShared;
+			}
+		}
 	};
+	static_assert(sizeof(Var) == 16);
 
 	class Computer;
 	using DeviceFunction = std::function<Var(Computer*, const std::vector<Var>& args)>;
 	using DeviceObjectMember = std::function<Var(Computer*, const Var& obj, const std::vector<Var>& args)>;
 	using OutputFunction = std::function<void(Computer*, uint32_t ioNumber, const std::vector<Var>& args)>;
+	struct ByteCode;
+	// Native entry point of a typed device function (see DeclareDeviceFunction<Signature>), reads the arguments straight from the computer's memory and writes the return value into dst
+	using DeviceFunctionThunk = void(*)(Computer*, const void* function, const ByteCode* args, ByteCode dst);
 
 	struct ObjectType {
 		uint8_t id;
 		std::string name;
 	};
 
-	struct Device {
-		static std::unordered_map<std::string, ObjectType> objectTypesByName;
-		static std::unordered_map<uint8_t, std::string> objectNamesById;
-		static std::vector<std::string> objectTypesList;
+	// Everything an implementation declares for a kind of device: global constants, entry points, object types, device functions and the output function.
+	// Programs are parsed, compiled and run against one context, its tables are only read once the declarations are done so they may be shared by many threads.
+	// The free Declare* functions below operate on the default context (GetDefaultDeviceContext).
+	struct DeviceContext {
+		std::unordered_map<std::string, double> globalNumericConstants {};
+		std::unordered_map<std::string, std::string> globalTextConstants {};
+		std::vector<std::string> entryPoints {};
+		
+		std::unordered_map<std::string, ObjectType> objectTypesByName {};
+		std::unordered_map<uint8_t, std::string> objectNamesById {};
+		std::vector<std::string> objectTypesList {};
 
 		struct FunctionInfo {
 			struct Arg {
@@ -2430,7 +2906,7 @@ const int VERSION_PATCH = 0;
 			std::string returnType = "";
 			std::string key = "";
 			
-			FunctionInfo(uint32_t id_, const std::string& line) : id(id_) {
+			FunctionInfo(uint32_t id_, const std::string& line, const DeviceContext& context) : id(id_) {
 				std::vector<Word> words;
 				
 				int nextWordIndex = 0;
@@ -2473,7 +2949,7 @@ const int VERSION_PATCH = 0;
 						assert(word == Word::Varname);
 						readWord(Word::CastOperator);
 						std::string type = readWord(Word::Name);
-						if (type != "number" && type != "text" && !objectTypesByName.contains(type)) {
+						if (type != "number" && type != "text" && !context.objectTypesByName.contains(type)) {
 							assert(!"Invalid argument type in device function prototype");
 						}
 						args.emplace_back(std::string(word), type);
@@ -2484,7 +2960,7 @@ const int VERSION_PATCH = 0;
 				// Return type
 				if (nextWord == Word::CastOperator) {
 					Word type = readWord(Word::Name);
-					if (type != "number" && type != "text" && !objectTypesByName.contains(type)) {
+					if (type != "number" && type != "text" && !context.objectTypesByName.contains(type)) {
 						assert(!"Invalid return type in device function prototype");
 					}
 					returnType = std::string(type);
@@ -2492,115 +2968,205 @@ const int VERSION_PATCH = 0;
 			}
 		};
 
-		static std::unordered_map<std::string, Device::FunctionInfo> deviceFunctionsByName;
-		static std::unordered_map<uint32_t/*24 least significant bits only*/, std::string> deviceFunctionNamesById;
-		static std::unordered_map<uint32_t/*24 least significant bits only*/, DeviceFunction> deviceFunctionsById;
-		static std::unordered_map<uint32_t/*24 least significant bits only*/, bool> deviceFunctionHasReturn; // Cached for fast lookup
-		static std::unordered_map<uint8_t/*objectId*/, std::vector<std::string>> deviceFunctionsList;
+		std::unordered_map<std::string, FunctionInfo> deviceFunctionsByName {};
+		std::unordered_map<uint32_t/*24 least significant bits only*/, std::string> deviceFunctionNamesById {};
+		std::unordered_map<uint32_t/*24 least significant bits only*/, DeviceFunction> deviceFunctionsById {};
+		std::unordered_map<uint32_t/*24 least significant bits only*/, bool> deviceFunctionHasReturn {}; // Cached for fast lookup
+		std::unordered_map<uint8_t/*objectId*/, std::vector<std::string>> deviceFunctionsList {};
 
 		// Fast vector-based lookup: deviceFunctionVectors[base][functionIndex] gives the function pointer
 		// ID encoding: id = (functionIndex) | (base << 16), where functionIndex is 1-based
-		static std::vector<std::vector<DeviceFunction*>> deviceFunctionVectors;
-		static std::vector<std::vector<bool>> deviceFunctionHasReturnVectors;
+		std::vector<std::vector<DeviceFunction*>> deviceFunctionVectors = std::vector<std::vector<DeviceFunction*>>(128); // Pre-allocate for 128 bases
+		std::vector<std::vector<bool>> deviceFunctionHasReturnVectors = std::vector<std::vector<bool>>(128);
+		
+		// Typed device functions, same indexing as deviceFunctionVectors (thunk is nullptr when declared with a DeviceFunction only)
+		struct TypedFunction {
+			DeviceFunctionThunk thunk = nullptr;
+			std::shared_ptr<const void> function {}; // std::function<Signature>
+			std::vector<Var::Type> args {}; // Var::Numeric or Var::Text
+		};
+		std::vector<std::vector<TypedFunction>> deviceFunctionTypedVectors = std::vector<std::vector<TypedFunction>>(128);
+		
+		OutputFunction outputFunction = [](Computer*, uint32_t, const std::vector<Var>&){};
+		
+		std::map<uint8_t, uint32_t> nextDeviceFunctionID {};
+		uint8_t nextObjectTypeID = 0;
+		
+		DeviceContext() {}
+		DeviceContext(const DeviceContext&) = delete; // deviceFunctionVectors point into deviceFunctionsById
+		DeviceContext& operator=(const DeviceContext&) = delete;
+		
+		bool IsObjectType(uint8_t id) const {
+			return objectNamesById.contains(id);
+		}
+		std::string GetObjectTypeName(uint8_t id) const {
+			auto it = objectNamesById.find(id);
+			return it != objectNamesById.end()? it->second : "";
+		}
+		const std::vector<std::string>& GetFunctionKeys(uint8_t base) const {
+			static const std::vector<std::string> empty {};
+			auto it = deviceFunctionsList.find(base);
+			return it != deviceFunctionsList.end()? it->second : empty;
+		}
+
+		// Everything a compiled program depends on (the implementations of device functions and the output function excluded)
+		std::string GetFingerprint() const {
+			std::ostringstream s;
+			s << std::setprecision(17);
+			s << "OBJ";
+			for (const auto& name : objectTypesList) s << ' ' << name;
+			s << "\nFN";
+			for (const auto& [id, name] : std::map<uint32_t, std::string>(deviceFunctionNamesById.begin(), deviceFunctionNamesById.end())) {
+				const auto& f = deviceFunctionsByName.at(name);
+				s << ' ' << id << ':' << name << '(';
+				for (const auto& arg : f.args) s << arg.type << ',';
+				s << ')' << f.returnType;
+			}
+			s << "\nEP";
+			for (const auto& name : entryPoints) s << ' ' << name;
+			s << "\nNUM";
+			for (const auto& [name, value] : std::map<std::string, double>(globalNumericConstants.begin(), globalNumericConstants.end())) {
+				s << ' ' << name << '=' << value;
+			}
+			s << "\nTXT";
+			for (const auto& [name, value] : std::map<std::string, std::string>(globalTextConstants.begin(), globalTextConstants.end())) {
+				s << ' ' << name << '=' << value.size() << ':' << value;
+			}
+			return s.str();
+		}
+
+		// Declare a global numeric constant.
+		void DeclareGlobalConstant(std::string name, double value) {
+			strtolower(name);
+			assert(!name.empty() && name[0] != '$' && name[0] != '@');
+			assert(find(globalScopeFirstWords.begin(), globalScopeFirstWords.end(), name) == globalScopeFirstWords.end());
+			assert(!globalNumericConstants.contains(name));
+			globalNumericConstants.emplace(name, value);
+		}
+		
+		// Declare a global text constant.
+		void DeclareGlobalConstant(std::string name, const std::string& value) {
+			strtolower(name);
+			assert(!name.empty() && name[0] != '$' && name[0] != '@');
+			assert(find(globalScopeFirstWords.begin(), globalScopeFirstWords.end(), name) == globalScopeFirstWords.end());
+			assert(!globalTextConstants.contains(name));
+			globalTextConstants.emplace(name, value);
+		}
+		
+		// Implementation SHOULD declare entry points
+		void DeclareEntryPoint(std::string entryName) {
+			strtolower(entryName);
+			assert(find(globalScopeFirstWords.begin(), globalScopeFirstWords.end(), entryName) == globalScopeFirstWords.end());
+			entryPoints.emplace_back(entryName);
+		}
+		
+		// Implementation SHOULD declare (or override) device functions
+		FunctionInfo& DeclareDeviceFunction(const std::string& prototype, DeviceFunction&& func, uint8_t base = 0) {
+			FunctionInfo f {0, prototype, *this};
+			if (deviceFunctionsByName.contains(f.name)) {
+				if (base != 0) throw std::runtime_error("Cannot override a device object member");
+				auto& existingFuncRef = deviceFunctionsByName.at(f.name);
+				existingFuncRef.args = f.args;
+				existingFuncRef.returnType = f.returnType;
+				deviceFunctionsById[existingFuncRef.id] = std::forward<DeviceFunction>(func);
+				deviceFunctionHasReturn[existingFuncRef.id] = !f.returnType.empty(); // Update cache
+				// Update vector-based lookup for override
+				uint32_t funcIndex = existingFuncRef.id & 0xFFFF;
+				uint8_t funcBase = (existingFuncRef.id >> 16) & 0xFF;
+				deviceFunctionVectors[funcBase][funcIndex - 1] = &deviceFunctionsById[existingFuncRef.id];
+				deviceFunctionHasReturnVectors[funcBase][funcIndex - 1] = !f.returnType.empty();
+				deviceFunctionTypedVectors[funcBase][funcIndex - 1] = {};
+				return existingFuncRef;
+			}
+			assert(nextDeviceFunctionID[base] < 65535);
+			uint32_t id = (++nextDeviceFunctionID[base]) | (uint32_t(base) << 16);
+			f.id = id;
+			deviceFunctionsByName.emplace(f.name, f);
+			deviceFunctionNamesById.emplace(id, f.name);
+			auto& emplaced = deviceFunctionsById.emplace(id, std::forward<DeviceFunction>(func)).first->second;
+			deviceFunctionHasReturn.emplace(id, !f.returnType.empty()); // Cache hasReturn
+			// Populate vector-based fast lookup
+			uint32_t funcIndex = id & 0xFFFF; // 1-based
+			if (deviceFunctionVectors[base].size() < funcIndex) {
+				deviceFunctionVectors[base].resize(funcIndex, nullptr);
+				deviceFunctionHasReturnVectors[base].resize(funcIndex, false);
+				deviceFunctionTypedVectors[base].resize(funcIndex);
+			}
+			deviceFunctionVectors[base][funcIndex - 1] = &emplaced;
+			deviceFunctionHasReturnVectors[base][funcIndex - 1] = !f.returnType.empty();
+			deviceFunctionsList[base].emplace_back(f.key);
+			assert(deviceFunctionsList[base].size() == size_t(nextDeviceFunctionID[base]));
+			return deviceFunctionsByName.at(f.name);
+		}
+		
+		// Implementation MAY declare (or override) device functions with a native signature (see TypedDeviceFunctionTraits)
+		template<typename Signature, typename F>
+		FunctionInfo& DeclareDeviceFunction(const std::string& prototype, F&& func, uint8_t base = 0);
+		
+		// Implementation SHOULD declare object types
+		Var::Type DeclareObjectType(const std::string& name, const std::map<std::string, DeviceObjectMember>& members = {}) {
+			assert(nextObjectTypeID < 127);
+			uint8_t id = ++nextObjectTypeID;
+			objectTypesByName.emplace(name, ObjectType{id, name});
+			objectNamesById.emplace(id, name);
+			objectTypesList.emplace_back(name);
+			assert(objectTypesList.size() == size_t(id));
+			for (auto&[prototype, method] : members) {
+				auto& func = DeclareDeviceFunction(name + "::" + prototype, [method](Computer* computer, const std::vector<Var>& args) -> Var {
+					if (__builtin_expect(args.size() > 0, 1)) {
+						// Fast path: no additional args (common for property access like $obj.x)
+						if (__builtin_expect(args.size() == 1, 1)) {
+							static const std::vector<Var> emptyArgs;
+							return method(computer, args[0], emptyArgs);
+						}
+						return method(computer, args[0], std::vector<Var>(args.begin()+1, args.end()));
+					} else {
+						throw RuntimeError("Invalid object member arguments");
+					}
+				}, id);
+				func.args.insert(func.args.begin(), FunctionInfo::Arg{"_this", name});
+			}
+			return Var::Type(Var::Object | id);
+		}
 		
-		static OutputFunction outputFunction;
+		// Implementation SHOULD set this function
+		void SetOutputFunction(OutputFunction&& func) {
+			outputFunction = std::forward<OutputFunction>(func);
+		}
 	};
+	
+	inline static bool IsDeclaredEntryPoint(const DeviceContext& context, const std::string& name) {
+		return find(begin(context.entryPoints), end(context.entryPoints), name) != end(context.entryPoints);
+	}
 
-	// Declare a global numeric constant.
-	static void DeclareGlobalConstant(std::string name, double value)
-	{
-		strtolower(name);
-		assert(!name.empty() && name[0] != '$' && name[0] != '@');
-		assert(find(globalScopeFirstWords.begin(), globalScopeFirstWords.end(), name) == globalScopeFirstWords.end());
-		assert(!Implementation::globalNumericConstants.contains(name));
-		Implementation::globalNumericConstants.emplace(name, value);
+	// Declare a global numeric constant (in the default context).
+	inline static void DeclareGlobalConstant(std::string name, double value) {
+		GetDefaultDeviceContext().DeclareGlobalConstant(std::move(name), value);
 	}
 
-	// Declare a global text constant.
-	static void DeclareGlobalConstant(std::string name, const std::string& value)
-	{
-		strtolower(name);
-		assert(!name.empty() && name[0] != '$' && name[0] != '@');
-		assert(find(globalScopeFirstWords.begin(), globalScopeFirstWords.end(), name) == globalScopeFirstWords.end());
-		assert(!Implementation::globalTextConstants.contains(name));
-		Implementation::globalTextConstants.emplace(name, value);
+	// Declare a global text constant (in the default context).
+	inline static void DeclareGlobalConstant(std::string name, const std::string& value) {
+		GetDefaultDeviceContext().DeclareGlobalConstant(std::move(name), value);
 	}
 	
-	// Implementation SHOULD declare entry points
+	// Implementation SHOULD declare entry points (in the default context)
 	inline static void DeclareEntryPoint(std::string entryName) {
-		strtolower(entryName);
-		assert(find(globalScopeFirstWords.begin(), globalScopeFirstWords.end(), entryName) == globalScopeFirstWords.end());
-		Implementation::entryPoints.emplace_back(entryName);
+		GetDefaultDeviceContext().DeclareEntryPoint(std::move(entryName));
 	}
 
-	// Implementation SHOULD declare (or override) device functions
-	inline static Device::FunctionInfo& DeclareDeviceFunction(const std::string& prototype, DeviceFunction&& func, uint8_t base = 0) {
-		Device::FunctionInfo f {0, prototype};
-		if (Device::deviceFunctionsByName.contains(f.name)) {
-			if (base != 0) throw std::runtime_error("Cannot override a device object member");
-			auto& existingFuncRef = Device::deviceFunctionsByName.at(f.name);
-			existingFuncRef.args = f.args;
-			existingFuncRef.returnType = f.returnType;
-			Device::deviceFunctionsById[existingFuncRef.id] = std::forward<DeviceFunction>(func);
-			Device::deviceFunctionHasReturn[existingFuncRef.id] = !f.returnType.empty(); // Update cache
-			// Update vector-based lookup for override
-			uint32_t funcIndex = existingFuncRef.id & 0xFFFF;
-			uint8_t funcBase = (existingFuncRef.id >> 16) & 0xFF;
-			Device::deviceFunctionVectors[funcBase][funcIndex - 1] = &Device::deviceFunctionsById[existingFuncRef.id];
-			Device::deviceFunctionHasReturnVectors[funcBase][funcIndex - 1] = !f.returnType.empty();
-			return existingFuncRef;
-		}
-		static std::map<uint8_t, uint32_t> nextID {};
-		assert(nextID[base] < 65535);
-		uint32_t id = (++nextID[base]) | (uint32_t(base) << 16);
-		f.id = id;
-		Device::deviceFunctionsByName.emplace(f.name, f);
-		Device::deviceFunctionNamesById.emplace(id, f.name);
-		auto& emplaced = Device::deviceFunctionsById.emplace(id, std::forward<DeviceFunction>(func)).first->second;
-		Device::deviceFunctionHasReturn.emplace(id, !f.returnType.empty()); // Cache hasReturn
-		// Populate vector-based fast lookup
-		uint32_t funcIndex = id & 0xFFFF; // 1-based
-		if (Device::deviceFunctionVectors[base].size() < funcIndex) {
-			Device::deviceFunctionVectors[base].resize(funcIndex, nullptr);
-			Device::deviceFunctionHasReturnVectors[base].resize(funcIndex, false);
-		}
-		Device::deviceFunctionVectors[base][funcIndex - 1] = &emplaced;
-		Device::deviceFunctionHasReturnVectors[base][funcIndex - 1] = !f.returnType.empty();
-		Device::deviceFunctionsList[base].emplace_back(f.key);
-		assert(Device::deviceFunctionsList[base].size() == size_t(nextID[base]));
-		return Device::deviceFunctionsByName.at(f.name);
+	// Implementation SHOULD declare (or override) device functions (in the default context)
+	inline static DeviceContext::FunctionInfo& DeclareDeviceFunction(const std::string& prototype, DeviceFunction&& func, uint8_t base = 0) {
+		return GetDefaultDeviceContext().DeclareDeviceFunction(prototype, std::forward<DeviceFunction>(func), base);
 	}
 
-	// Implementation SHOULD declare object types
+	// Implementation SHOULD declare object types (in the default context)
 	inline static Var::Type DeclareObjectType(const std::string& name, const std::map<std::string, DeviceObjectMember>& members = {}) {
-		static uint8_t nextID = 0;
-		assert(nextID < 127);
-		uint8_t id = ++nextID;
-		Device::objectTypesByName.emplace(name, ObjectType{id, name});
-		Device::objectNamesById.emplace(id, name);
-		Device::objectTypesList.emplace_back(name);
-		assert(Device::objectTypesList.size() == size_t(id));
-		for (auto&[prototype, method] : members) {
-			auto& func = DeclareDeviceFunction(name + "::" + prototype, [method](Computer* computer, const std::vector<Var>& args) -> Var {
-				if (__builtin_expect(args.size() > 0, 1)) {
-					// Fast path: no additional args (common for property access like $obj.x)
-					if (__builtin_expect(args.size() == 1, 1)) {
-						static const std::vector<Var> emptyArgs;
-						return method(computer, args[0], emptyArgs);
-					}
-					return method(computer, args[0], std::vector<Var>(args.begin()+1, args.end()));
-				} else {
-					throw RuntimeError("Invalid object member arguments");
-				}
-			}, id);
-			func.args.insert(func.args.begin(), Device::FunctionInfo::Arg{"_this", name});
-		}
-		return Var::Type(Var::Object | id);
+		return GetDefaultDeviceContext().DeclareObjectType(name, members);
 	}
 
-	// Implementation SHOULD set this function
+	// Implementation SHOULD set this function (in the default context)
 	inline static void SetOutputFunction(OutputFunction&& func) {
-		Device::outputFunction = std::forward<OutputFunction>(func);
+		GetDefaultDeviceContext().SetOutputFunction(std::forward<OutputFunction>(func));
 	}
 
 	struct Stack {
@@ -2750,63 +3316,1505 @@ const int VERSION_PATCH = 0;
 			case RAM_VAR_TEXT:
 			return true;
 		}
-		return v.type >= RAM_OBJECT;
-	}
-
-	inline static bool IsArray(ByteCode v) {
-		switch (v.type) {
-			case STORAGE_ARRAY_NUMERIC:
-			case STORAGE_ARRAY_TEXT:
-			case RAM_ARRAY_NUMERIC:
-			case RAM_ARRAY_TEXT:
-			return true;
+		return v.type >= RAM_OBJECT;
+	}
+
+	inline static bool IsArray(ByteCode v) {
+		switch (v.type) {
+			case STORAGE_ARRAY_NUMERIC:
+			case STORAGE_ARRAY_TEXT:
+			case RAM_ARRAY_NUMERIC:
+			case RAM_ARRAY_TEXT:
+			return true;
+		}
+		return false;
+	}
+
+	inline static bool IsStorage(ByteCode v) {
+		switch (v.type) {
+			case STORAGE_ARRAY_NUMERIC:
+			case STORAGE_ARRAY_TEXT:
+			case STORAGE_VAR_NUMERIC:
+			case STORAGE_VAR_TEXT:
+			return true;
+		}
+		return false;
+	}
+	
+	// Does not include arrays
+	inline static bool IsNumeric(ByteCode v) noexcept {
+		// Fast path for most common case: RAM variable (type 70)
+		// Types: ROM_CONST_NUMERIC=40, STORAGE_VAR_NUMERIC=50, RAM_VAR_NUMERIC=70
+		return v.type == RAM_VAR_NUMERIC || v.type == ROM_CONST_NUMERIC || v.type == STORAGE_VAR_NUMERIC;
+	}
+
+	// Does not include arrays
+	inline static bool IsText(ByteCode v) noexcept {
+		// Types: ROM_CONST_TEXT=41, STORAGE_VAR_TEXT=51, RAM_VAR_TEXT=71
+		return v.type == RAM_VAR_TEXT || v.type == ROM_CONST_TEXT || v.type == STORAGE_VAR_TEXT;
+	}
+
+	inline static bool IsObject(ByteCode v) noexcept {
+		return v.type >= RAM_OBJECT;
+	}
+
+	struct TimerFunction {
+		double interval;
+		uint32_t addr;
+	};
+
+	struct InputFunction {
+		uint32_t addr = 0;
+		std::vector<uint32_t> args {};
+	};
+	
+	struct EntryPoint {
+		std::string name;
+		uint32_t addr = 0;
+		ByteCode ref = VOID;
+		std::vector<uint32_t> args {};
+	};
+	
+	// Source file and line of each address in a bytecode, kept aside so that the interpreter never has to execute them
+	struct DebugInfo {
+		// A call replaced by a copy of the function by the optimizer, so that errors within the copy still report the call
+		struct InlinedCall {
+			uint32_t begin; // copy of the function [begin, end)
+			uint32_t end; // where the caller continues
+			uint32_t line; // of the call
+			uint32_t sourceFile;
+		};
+		std::vector<std::pair<uint32_t/*addr*/, uint32_t/*line*/>> lines {}; // sorted by addr
+		std::vector<std::pair<uint32_t/*addr*/, uint32_t/*sourceFile*/>> files {}; // sorted by addr
+		std::vector<InlinedCall> inlinedCalls {}; // sorted by begin, a call containing another one comes first
+		
+		void AddLine(uint32_t addr, uint32_t line) {
+			if (!lines.empty() && lines.back().first == addr) lines.back().second = line;
+			else lines.emplace_back(addr, line);
+		}
+		void AddFile(uint32_t addr, uint32_t file) {
+			if (!files.empty() && files.back().first == addr) files.back().second = file;
+			else files.emplace_back(addr, file);
+		}
+		
+		// Value of the last entry at or before the given address, ~0u if none
+		static uint32_t Find(const std::vector<std::pair<uint32_t, uint32_t>>& entries, uint32_t addr) {
+			auto it = std::upper_bound(entries.begin(), entries.end(), addr, [](uint32_t a, const std::pair<uint32_t, uint32_t>& entry){ return a < entry.first; });
+			return it == entries.begin()? ~0u : std::prev(it)->second;
+		}
+		
+		// Find the last line and file declared at or before the given address
+		void Get(uint32_t addr, const std::vector<std::string>& sourceFiles, std::string_view& file, uint32_t& line) const {
+			line = Find(lines, addr);
+			if (line == ~0u) line = 0;
+			uint32_t f = Find(files, addr);
+			file = f >= sourceFiles.size()? "" : std::string_view(sourceFiles[f]);
+		}
+		
+		// Calls inlined where the given address is, innermost first
+		template<typename F>
+		void ForEachInlinedCall(uint32_t addr, F&& f) const {
+			for (auto call = inlinedCalls.rbegin(); call != inlinedCalls.rend(); ++call) {
+				if (call->begin <= addr && addr < call->end) f(*call);
+			}
+		}
+	};
+	
+	// One word of the pre-decoded dispatch stream (see Assembly::Predecode)
+	struct DecodedCode {
+		uint32_t opcodeIndex : 8; // OPCODE_INDEX
+		uint32_t link : 24; // for DEV, index of its DeviceCallSite
+	};
+	
+	// A device function call site (DEV), linked once when the program is loaded
+	struct DeviceCallSite {
+		enum Marshalling : uint8_t {
+			INVALID_FUNCTION = 0, // unknown device function
+			NO_ARGS_TO_NUMERIC, // no arguments, returns into a RAM numeric var
+			NUMERIC_ARGS_TO_NUMERIC, // only numeric arguments, returns into a RAM numeric var (non-numeric returns are ignored)
+			ARGS_TO_NUMERIC, // starts with one or two numeric arguments or a single object, returns into a RAM numeric var (non-numeric returns are ignored)
+			GENERIC,
+		};
+		enum ArgKind : uint8_t {
+			ARG_INVALID = 0,
+			ARG_NUMERIC,
+			ARG_TEXT,
+			ARG_OBJECT,
+		};
+		DeviceFunction* function = nullptr;
+		ByteCode dst = 0; // RET_DST, or 0 if the function does not return anything
+		uint32_t argsAddr = 0; // address of the first argument
+		uint32_t endAddr = 0; // address of the VOID following the last argument
+		uint32_t argKinds = 0; // offset of this call's ArgKind signature in Assembly::deviceCallArgKinds
+		Marshalling marshalling = INVALID_FUNCTION;
+		DeviceFunctionThunk thunk = nullptr; // set when the function was declared with a native signature that matches the arguments of this call
+		std::shared_ptr<const void> typedFunction {}; // only called while it is still the one declared for functionId, the function may be overridden after the program is loaded
+		uint32_t functionId = 0; // DEVICE_FUNCTION_INDEX, set with thunk
+	};
+	
+	// A counted loop over the size of a RAM numeric array that is not resized within the loop (see Assembly::FindIndexedLoops)
+	struct IndexedLoop {
+		uint32_t begin = 0; // first statement of the straight code before the head that sets the index and the count
+		uint32_t head = 0; // INC index, LST cond index count, CND body end cond, followed by the body
+		uint32_t end = 0; // first statement after the loop
+		ByteCode index = 0;
+		ByteCode count = 0;
+		ByteCode array = 0;
+	};
+
+	// User-defined symbols of the program being compiled
+	// Names (of variables and functions) are interned once, then symbols are bound in a flat table keyed by function and symbol ids
+	// A name may only be bound once per function (declarations cannot shadow), the stack level it was bound at is kept to unbind it when leaving that level
+	class SymbolTable {
+		struct Binding {
+			int stackId;
+			ByteCode value;
+		};
+		std::unordered_map<std::string, uint32_t> ids {};
+		std::vector<std::string> names {};
+		std::unordered_map<uint64_t/*function << 32 | symbol*/, Binding> bindings {};
+		std::unordered_map<uint64_t/*function << 32 | stackId*/, std::vector<uint32_t>> declared {}; // symbols bound by each function and stack level
+
+		static uint64_t Key(uint32_t function, uint32_t symbolOrStackId) {
+			return uint64_t(function) << 32 | symbolOrStackId;
+		}
+
+	public:
+		inline static const uint32_t NONE = ~0u;
+
+		uint32_t Intern(const std::string& name) {
+			auto [it, inserted] = ids.try_emplace(name, uint32_t(names.size()));
+			if (inserted) {
+				names.push_back(name);
+			}
+			return it->second;
+		}
+
+		// NONE if the name was never interned (hence never bound)
+		uint32_t Find(const std::string& name) const {
+			auto it = ids.find(name);
+			return it != ids.end()? it->second : NONE;
+		}
+
+		// Bound in the given function, at any stack level
+		const ByteCode* Get(uint32_t function, uint32_t symbol) const {
+			if (function == NONE || symbol == NONE) return nullptr;
+			auto it = bindings.find(Key(function, symbol));
+			return it != bindings.end()? &it->second.value : nullptr;
+		}
+
+		// Bound in the given function at the given stack level
+		const ByteCode* Get(uint32_t function, int stackId, uint32_t symbol) const {
+			if (function == NONE || symbol == NONE) return nullptr;
+			auto it = bindings.find(Key(function, symbol));
+			return it != bindings.end() && it->second.stackId == stackId? &it->second.value : nullptr;
+		}
+
+		// Does not replace an existing binding
+		void Bind(uint32_t function, int stackId, uint32_t symbol, ByteCode value) {
+			if (bindings.try_emplace(Key(function, symbol), Binding{stackId, value}).second) {
+				declared[Key(function, uint32_t(stackId))].push_back(symbol);
+			}
+		}
+
+		// Unbind everything at the given level
+		void Clear(uint32_t function, int stackId) {
+			auto it = declared.find(Key(function, uint32_t(stackId)));
+			if (it == declared.end()) return;
+			for (uint32_t symbol : it->second) {
+				bindings.erase(Key(function, symbol));
+			}
+			declared.erase(it);
+		}
+
+		// Unbind everything in the given function
+		void Clear(uint32_t function) {
+			std::vector<int> stackIds;
+			for (const auto& [level, symbols] : declared) {
+				if (uint32_t(level >> 32) == function) stackIds.push_back(int(uint32_t(level)));
+			}
+			for (int stackId : stackIds) Clear(function, stackId);
+		}
+
+		// Replace the value of every binding, once the variables they refer to were renumbered
+		template<typename F>
+		void Remap(F&& f) {
+			for (auto& [key, b] : bindings) b.value = f(b.value);
+		}
+		
+		// Name of a bound symbol with this value (for debugging)
+		const std::string* GetName(ByteCode value) const {
+			for (const auto& [key, b] : bindings) {
+				if (b.value.type == value.type && b.value.value == value.value) return &names[uint32_t(key)];
+			}
+			return nullptr;
+		}
+	};
+
+	// Bytecode optimization passes, run by the compiler on a freshly compiled program before it is written (see XC_OPTIMIZATION_LEVEL)
+	// Level 1: constant folding, constant conditions, jump threading and unreachable code removal (including the functions that are never called)
+	// Level 2: also copy propagation, store forwarding and dead store elimination on the temporaries of functions
+	// Instructions are only rewritten in place or removed, the program is compacted and all addresses remapped at the end.
+	class Optimizer {
+	public:
+		// A compiled function, owning the RAM variables that were allocated while compiling it
+		struct Function {
+			uint32_t addr = 0; // of its first instruction
+			uint32_t end = 0; // right after its last instruction
+			bool recursive = false;
+			ByteCode returnVar = VOID; // VOID if it does not return a value
+			std::vector<ByteCode> params {};
+			uint32_t numericVariables[2] {}; // [begin, end)
+			uint32_t textVariables[2] {}; // [begin, end)
+			std::vector<ByteCode> pool[2] {}; // numeric and text temporaries holding the variables of the functions inlined into this one
+		};
+		
+	private:
+		std::vector<ByteCode>& program;
+		std::vector<double>& numericConstants;
+		std::vector<std::string>& textConstants;
+		DebugInfo& debug;
+		uint32_t& ramNumericVariables;
+		uint32_t& ramTextVariables;
+		std::vector<uint32_t*> roots {}; // addresses referenced from outside of the program (functions, timers, inputs, entry points)
+		std::unordered_set<uint32_t> temporaries {}; // raw values of the temporaries of functions, always written before being read within a call and never read by another function
+		std::vector<Function> functions {}; // sorted by addr
+		std::unordered_map<uint64_t/*bits*/, uint32_t> numericConstantsIndex {};
+		std::unordered_map<std::string, uint32_t> textConstantsIndex {};
+		
+		struct Instruction {
+			uint32_t addr; // of its first word
+			uint32_t size; // number of words, may only shrink
+			bool removed = false;
+			bool leader = false; // first instruction of a basic block
+		};
+		std::vector<Instruction> code {};
+		std::vector<uint32_t> instructionAt {}; // index in code of the instruction starting at each address, NONE within an instruction
+		inline static const uint32_t NONE = ~0u;
+		
+		// Operand helpers (operands are the words between the opcode and the trailing VOID)
+		ByteCode& Word(const Instruction& ins, uint32_t i) const {return program[ins.addr + i];}
+		ByteCode Opcode(const Instruction& ins) const {return program[ins.addr];}
+		uint32_t OperandsCount(const Instruction& ins) const {
+			if (Opcode(ins).type != OP) return 0;
+			if (Opcode(ins) == STR || Opcode(ins) == RST) return 3;
+			return ins.size - 2;
+		}
+		bool IsTemporary(ByteCode ref) const {
+			return (ref.type == RAM_VAR_NUMERIC || ref.type == RAM_VAR_TEXT) && temporaries.contains(ref.rawValue);
+		}
+		
+		// REF_DST followed by values that are only read, without side effects other than writing REF_DST
+		static bool IsPure(ByteCode op) {
+			switch (op.rawValue) {
+				case SET: case ADD: case SUB: case MUL: case DIV: case MOD: case POW: case CCT: case AND: case ORR: case XOR:
+				case EQQ: case NEQ: case LST: case GRT: case LTE: case GTE: case NOT: case FLR: case CIL: case RND:
+				case SIN: case COS: case TAN: case ASI: case ACO: case ATA: case ABS: case FRA: case SQR: case SIG:
+				case LOG: case CLP: case STP: case SMT: case LRP: case NUM: case TXT: case SIZ: case LAS: case FND: case CON:
+				case MIN: case MAX: case AVG: case SUM: case MED: case SBS: case IDX: case HSH: case UPP: case LCC: case ISN: case IFF: case RPL:
+					return true;
+				default: return false;
+			}
+		}
+		// Pure instructions that can never throw, hence may be removed when their result is not used
+		static bool IsRemovable(ByteCode op) {
+			switch (op.rawValue) {
+				case SET: case ADD: case SUB: case MUL: case POW: case AND: case ORR: case XOR:
+				case EQQ: case NEQ: case LST: case GRT: case LTE: case GTE: case NOT: case FLR: case CIL: case RND: case ABS:
+					return true;
+				default: return false;
+			}
+		}
+		// Pure instructions that cannot throw when their operands have the right types, hence may run even when the original code would not
+		static bool IsHoistable(ByteCode op) {
+			if (IsRemovable(op)) return true;
+			switch (op.rawValue) {
+				case SIN: case COS: case TAN: case ASI: case ACO: case ATA: case FRA: case SQR: case SIG: case LOG:
+				case STP: case SMT: case LRP: case SIZ:
+					return true;
+				default: return false;
+			}
+		}
+		bool IsPureInstruction(const Instruction& ins) const {
+			if (!IsPure(Opcode(ins)) || OperandsCount(ins) == 0) return false;
+			ByteCode dst = Word(ins, 1);
+			return dst.type != ARRAY_INDEX && dst.type != OBJ_KEY; // SET into an array element or an object key modifies its REF_DST
+		}
+		
+		// The tracked variables that an instruction reads (uses) and overwrites entirely (def), a RETURN reads returnVar
+		template<typename Tracked>
+		void GetUsesAndDef(const Instruction& ins, Tracked&& tracked, std::vector<uint32_t>& uses, uint32_t& def, ByteCode returnVar = ByteCode(VOID)) const {
+			uses.clear();
+			def = NONE;
+			ByteCode op = Opcode(ins);
+			if (op.type == RETURN && returnVar.type != VOID && tracked(returnVar)) uses.push_back(returnVar.rawValue);
+			if (op.type != OP || op == JMP || op == GTO || op == RST) return;
+			if (op == STR) {
+				// Saves a range of local variables before a recursive call
+				ByteCode type = Word(ins, 3);
+				for (uint32_t i = Word(ins, 1).rawValue, end = i + Word(ins, 2).rawValue; i < end; ++i) {
+					if (tracked(ByteCode(type.type, i))) uses.push_back(ByteCode(type.type, i).rawValue);
+				}
+				return;
+			}
+			bool pure = IsPureInstruction(ins);
+			for (uint32_t i = 1, count = OperandsCount(ins); i <= count; ++i) {
+				ByteCode ref = Word(ins, i);
+				if (!tracked(ref)) continue;
+				if (i == 1 && pure) def = ref.rawValue;
+				else uses.push_back(ref.rawValue);
+			}
+		}
+		
+		// Index of the first instruction that is not removed, starting at the given one
+		uint32_t Resolve(uint32_t index) const {
+			while (index < code.size() && code[index].removed) ++index;
+			return index;
+		}
+		uint32_t Next(uint32_t index) const {
+			return Resolve(index + 1);
+		}
+		uint32_t Target(ByteCode addr) const {
+			if (addr.value >= program.size()) return code.size();
+			return Resolve(instructionAt[addr.value]);
+		}
+		uint32_t AddrOf(uint32_t index) const {
+			return index < code.size()? code[index].addr : program.size();
+		}
+		void Remove(Instruction& ins) {
+			ins.removed = true;
+		}
+		
+		uint32_t AddNumericConstant(double value) {
+			auto [it, inserted] = numericConstantsIndex.try_emplace(std::bit_cast<uint64_t>(value), uint32_t(numericConstants.size()));
+			if (inserted) numericConstants.push_back(value);
+			return it->second;
+		}
+		uint32_t AddTextConstant(const std::string& value) {
+			auto [it, inserted] = textConstantsIndex.try_emplace(value, uint32_t(textConstants.size()));
+			if (inserted) textConstants.push_back(value);
+			return it->second;
+		}
+		// Numeric result of an instruction with the given number of constant operands, false if it must be left to the runtime (unsupported or throws)
+		static bool Evaluate(ByteCode op, uint32_t operands, double x, double y, double& value) {
+			if (operands == 2) switch (op.rawValue) {
+				case ADD: value = x + y; break;
+				case SUB: value = x - y; break;
+				case MUL: value = x * y; break;
+				case DIV: if (y == 0) return false; value = x / y; break; // must still throw at runtime
+				case MOD:
+					if (std::fmod(x, 1.0) == 0.0 && std::fmod(y, 1.0) == 0.0) {
+						if (std::round(y) == 0) return false;
+						value = double(int64_t(std::round(x)) % int64_t(std::round(y)));
+					} else {
+						if (y == 0.0) return false;
+						value = std::fmod(x, y);
+					}
+					break;
+				case POW: value = std::pow(x, y); break;
+				case AND: value = double(std::abs(x) > EPSILON_DOUBLE && std::abs(y) > EPSILON_DOUBLE); break;
+				case ORR: value = double(std::abs(x) > EPSILON_DOUBLE || std::abs(y) > EPSILON_DOUBLE); break;
+				case XOR: value = double((std::abs(x) > EPSILON_DOUBLE) != (std::abs(y) > EPSILON_DOUBLE)); break;
+				case EQQ: value = double(std::abs(x - y) < EPSILON_DOUBLE); break;
+				case NEQ: value = double(std::abs(x - y) >= EPSILON_DOUBLE); break;
+				case LST: value = double(x < y); break;
+				case GRT: value = double(x > y); break;
+				case LTE: value = double(x <= y); break;
+				case GTE: value = double(x >= y); break;
+				default: return false;
+			} else switch (op.rawValue) {
+				case SET: value = x; break;
+				case NOT: value = double(std::abs(x) <= EPSILON_DOUBLE); break;
+				case FLR: value = std::floor(x); break;
+				case CIL: value = std::ceil(x); break;
+				case RND: value = std::round(x); break;
+				case ABS: value = std::abs(x); break;
+				default: return false;
+			}
+			return true;
+		}
+		// Constants are written as text with a fixed precision, a folded value must read back exactly as it would have been computed at runtime
+		static bool IsWritableExactly(double value) {
+			if (!std::isfinite(value) || (value == 0 && std::signbit(value))) return false;
+			std::istringstream s(ToStringHighPrecision(value));
+			double read;
+			return (s >> read) && read == value;
+		}
+		
+		bool Decode() {
+			code.clear();
+			instructionAt.assign(program.size() + 1, NONE);
+			for (uint32_t addr = 0; addr < program.size();) {
+				ByteCode c = program[addr];
+				uint32_t size = 1;
+				if (c.type == OP) {
+					if (c == STR || c == RST) {
+						size = 4;
+					} else {
+						while (addr + size < program.size() && program[addr + size].type != VOID) ++size;
+						++size;
+					}
+					if (addr + size > program.size()) return false;
+				} else if (c.type != RETURN && c.type != VOID) {
+					return false;
+				}
+				instructionAt[addr] = code.size();
+				code.push_back({addr, size});
+				addr += size;
+			}
+			instructionAt[program.size()] = code.size();
+			
+			// All addresses must point to the start of an instruction
+			auto valid = [this](uint32_t addr){ return addr >= program.size() || instructionAt[addr] != NONE; };
+			for (const Instruction& ins : code) {
+				ByteCode op = Opcode(ins);
+				if (op == JMP || op == GTO || op == CND) {
+					uint32_t count = op == CND? 2 : 1;
+					if (OperandsCount(ins) < count) return false;
+					for (uint32_t i = 1; i <= count; ++i) {
+						if (Word(ins, i).type != ADDR || !valid(Word(ins, i).value)) return false;
+					}
+				}
+			}
+			for (uint32_t* addr : roots) {
+				if (!valid(*addr)) return false;
+			}
+			return true;
+		}
+		
+		void FindLeaders() {
+			for (Instruction& ins : code) ins.leader = false;
+			auto mark = [this](uint32_t index){ if (index < code.size()) code[index].leader = true; };
+			mark(Resolve(0));
+			for (uint32_t* addr : roots) mark(Target(ByteCode(ADDR, *addr)));
+			for (uint32_t i = Resolve(0); i < code.size(); i = Next(i)) {
+				ByteCode op = Opcode(code[i]);
+				if (op == GTO) {
+					mark(Target(Word(code[i], 1)));
+				} else if (op == CND) {
+					mark(Target(Word(code[i], 1)));
+					mark(Target(Word(code[i], 2)));
+				}
+				if (op == GTO || op == CND || op.type == RETURN) mark(Next(i));
+			}
+		}
+		
+		// Successors within the same function (a call returns right after its JMP)
+		template<typename F>
+		void ForEachSuccessor(uint32_t index, F&& f) const {
+			ByteCode op = Opcode(code[index]);
+			if (op.type == RETURN) return;
+			if (op == GTO) {
+				f(Target(Word(code[index], 1)));
+			} else if (op == CND) {
+				f(Target(Word(code[index], 1)));
+				f(Target(Word(code[index], 2)));
+			} else {
+				f(Next(index));
+			}
+		}
+		
+		// Pass: operations on constants are computed at compile time, and conditional jumps on a constant become gotos
+		bool FoldConstants() {
+			bool changed = false;
+			for (uint32_t i = Resolve(0); i < code.size(); i = Next(i)) {
+				Instruction& ins = code[i];
+				ByteCode op = Opcode(ins);
+				uint32_t count = OperandsCount(ins);
+				if (op == CND && count == 3) {
+					ByteCode ref = Word(ins, 3);
+					bool value;
+					if (ref.type == ROM_CONST_NUMERIC) value = std::abs(numericConstants[ref.value]) > EPSILON_DOUBLE;
+					else if (ref.type == ROM_CONST_TEXT) value = textConstants[ref.value] != "" && textConstants[ref.value] != "0";
+					else continue;
+					ByteCode target = Word(ins, value? 1 : 2);
+					Word(ins, 0) = GTO;
+					Word(ins, 1) = target;
+					Word(ins, 2) = VOID;
+					ins.size = 3;
+					changed = true;
+					continue;
+				}
+				if (count < 2 || count > 3 || !IsPureInstruction(ins)) continue;
+				ByteCode dst = Word(ins, 1);
+				ByteCode a = Word(ins, 2);
+				ByteCode b = count == 3? Word(ins, 3) : ByteCode{};
+				ByteCode result;
+				if (op == CCT && count == 3) {
+					if (dst.type != RAM_VAR_TEXT || a.type != ROM_CONST_TEXT || b.type != ROM_CONST_TEXT) continue;
+					std::string value = textConstants[a.value] + textConstants[b.value];
+					if (value.length() > XC_MAX_TEXT_LENGTH) continue;
+					result = ByteCode(ROM_CONST_TEXT, AddTextConstant(value));
+				} else {
+					if (dst.type != RAM_VAR_NUMERIC || a.type != ROM_CONST_NUMERIC || (count == 3 && b.type != ROM_CONST_NUMERIC)) continue;
+					double value;
+					if (op == SET || !Evaluate(op, count - 1, numericConstants[a.value], count == 3? numericConstants[b.value] : 0, value)) continue; // SET is already a constant
+					if (!IsWritableExactly(value)) continue;
+					result = ByteCode(ROM_CONST_NUMERIC, AddNumericConstant(value));
+				}
+				Word(ins, 0) = SET;
+				Word(ins, 1) = dst;
+				Word(ins, 2) = result;
+				Word(ins, 3) = VOID;
+				ins.size = 4;
+				changed = true;
+			}
+			return changed;
+		}
+		
+		// Pass: jumps to a goto go straight to its destination, and gotos to the next instruction are removed
+		bool ThreadJumps() {
+			bool changed = false;
+			for (uint32_t i = Resolve(0); i < code.size(); i = Next(i)) {
+				Instruction& ins = code[i];
+				ByteCode op = Opcode(ins);
+				if (op != GTO && op != CND) continue;
+				for (uint32_t a = 1; a <= (op == CND? 2u : 1u); ++a) {
+					uint32_t target = Target(Word(ins, a));
+					for (int hops = 0; hops < 16 && target < code.size() && Opcode(code[target]) == GTO && target != i; ++hops) {
+						target = Target(Word(code[target], 1));
+					}
+					if (AddrOf(target) != Word(ins, a).value) {
+						Word(ins, a).value = AddrOf(target);
+						changed = true;
+					}
+				}
+				if (op == GTO && Target(Word(ins, 1)) == Next(i)) {
+					Remove(ins);
+					changed = true;
+				}
+			}
+			return changed;
+		}
+		
+		// Pass: instructions that cannot be reached from any root are removed
+		bool RemoveUnreachable() {
+			std::vector<bool> reachable(code.size(), false);
+			std::vector<uint32_t> pending {};
+			auto reach = [&](uint32_t index){
+				if (index < code.size() && !reachable[index]) {
+					reachable[index] = true;
+					pending.push_back(index);
+				}
+			};
+			reach(Resolve(0));
+			for (uint32_t* addr : roots) reach(Target(ByteCode(ADDR, *addr)));
+			while (!pending.empty()) {
+				uint32_t index = pending.back();
+				pending.pop_back();
+				if (Opcode(code[index]) == JMP) reach(Target(Word(code[index], 1)));
+				ForEachSuccessor(index, reach);
+			}
+			bool changed = false;
+			for (uint32_t i = 0; i < code.size(); ++i) {
+				if (!code[i].removed && !reachable[i]) {
+					Remove(code[i]);
+					changed = true;
+				}
+			}
+			return changed;
+		}
+		
+		// Pass: within a basic block, the reads of a temporary that is a copy of a variable or a constant read the original instead
+		bool PropagateCopies() {
+			bool changed = false;
+			FindLeaders();
+			std::vector<std::pair<uint32_t/*tmp*/, ByteCode/*original*/>> copies {};
+			for (uint32_t i = Resolve(0); i < code.size(); i = Next(i)) {
+				Instruction& ins = code[i];
+				if (ins.leader) copies.clear();
+				ByteCode op = Opcode(ins);
+				bool pure = IsPureInstruction(ins);
+				uint32_t count = OperandsCount(ins);
+				if (!copies.empty() && (pure || op == CND || op == OUT)) {
+					ByteCode dst = pure? Word(ins, 1) : ByteCode{};
+					for (uint32_t o = (pure? 2 : op == CND? 3 : 1); o <= count; ++o) {
+						ByteCode& ref = Word(ins, o);
+						if (!IsTemporary(ref)) continue;
+						bool container = op == IDX && o == 2; // indexing an object key requires a variable
+						for (const auto& [tmp, original] : copies) {
+							if (tmp == ref.rawValue && original.rawValue != dst.rawValue && !(container && original.type == ROM_CONST_TEXT)) {
+								ref = original;
+								changed = true;
+								break;
+							}
+						}
+					}
+				}
+				if (pure) {
+					ByteCode dst = Word(ins, 1);
+					std::erase_if(copies, [dst](const auto& copy){ return copy.first == dst.rawValue || copy.second.rawValue == dst.rawValue; });
+					if (op == SET && count == 2 && IsTemporary(dst)) {
+						ByteCode src = Word(ins, 2);
+						bool numeric = dst.type == RAM_VAR_NUMERIC;
+						if (src.rawValue != dst.rawValue && (src.type == (numeric? RAM_VAR_NUMERIC : RAM_VAR_TEXT) || src.type == (numeric? ROM_CONST_NUMERIC : ROM_CONST_TEXT))) {
+							copies.emplace_back(dst.rawValue, src);
+						}
+					}
+				} else if (op.type == OP && op != CND && op != OUT) {
+					copies.clear(); // calls, device functions and everything else that may write variables
+				}
+			}
+			return changed;
+		}
+		
+		// Liveness of the tracked variables at the start and at the end of each basic block within the instructions [first, last)
+		template<typename Tracked>
+		void ComputeLiveness(uint32_t first, uint32_t last, Tracked&& tracked, ByteCode returnVar, std::vector<uint32_t>& blocks, std::vector<std::vector<uint32_t>>& liveIn, std::vector<std::vector<uint32_t>>& liveOut) {
+			FindLeaders();
+			blocks.clear();
+			std::vector<uint32_t> blockOf(code.size() + 1, NONE);
+			for (uint32_t i = Resolve(first); i < last; i = Next(i)) {
+				if (code[i].leader || blocks.empty()) blocks.push_back(i);
+				blockOf[i] = blocks.size() - 1;
+			}
+			const size_t n = blocks.size();
+			std::vector<std::vector<uint32_t>> uses(n), defs(n);
+			std::vector<std::vector<uint32_t>> successors(n);
+			liveIn.assign(n, {});
+			liveOut.assign(n, {});
+			std::vector<uint32_t> insUses;
+			uint32_t insDef;
+			for (size_t b = 0; b < n; ++b) {
+				uint32_t end = b + 1 < n? blocks[b + 1] : last;
+				std::vector<uint32_t> members;
+				for (uint32_t i = blocks[b]; i < end; i = Next(i)) members.push_back(i);
+				// Backward through the block
+				std::unordered_set<uint32_t> use, def;
+				for (auto it = members.rbegin(); it != members.rend(); ++it) {
+					GetUsesAndDef(code[*it], tracked, insUses, insDef, returnVar);
+					if (insDef != NONE) {
+						def.insert(insDef);
+						use.erase(insDef);
+					}
+					for (uint32_t u : insUses) {
+						use.insert(u);
+					}
+				}
+				uses[b].assign(use.begin(), use.end());
+				defs[b].assign(def.begin(), def.end());
+				std::sort(uses[b].begin(), uses[b].end());
+				std::sort(defs[b].begin(), defs[b].end());
+				ForEachSuccessor(members.back(), [&](uint32_t s){
+					if (s < last && blockOf[s] != NONE) successors[b].push_back(blockOf[s]);
+				});
+				liveIn[b] = uses[b];
+			}
+			// Iterate until stable
+			for (bool changed = true; changed;) {
+				changed = false;
+				for (size_t b = n; b-- > 0;) {
+					std::vector<uint32_t> out;
+					for (uint32_t s : successors[b]) {
+						std::vector<uint32_t> merged;
+						std::set_union(out.begin(), out.end(), liveIn[s].begin(), liveIn[s].end(), std::back_inserter(merged));
+						out.swap(merged);
+					}
+					if (out == liveOut[b]) continue;
+					liveOut[b] = std::move(out);
+					std::vector<uint32_t> in;
+					std::set_difference(liveOut[b].begin(), liveOut[b].end(), defs[b].begin(), defs[b].end(), std::back_inserter(in));
+					std::vector<uint32_t> merged;
+					std::set_union(in.begin(), in.end(), uses[b].begin(), uses[b].end(), std::back_inserter(merged));
+					if (merged != liveIn[b]) {
+						liveIn[b] = std::move(merged);
+						changed = true;
+					}
+				}
+			}
+		}
+		
+		// Pass: an operation into a temporary that is only copied into a variable writes that variable directly, and stores into temporaries that are never read are removed
+		bool EliminateDeadStores() {
+			bool changed = false;
+			auto isTemporary = [this](ByteCode ref){ return IsTemporary(ref); };
+			std::vector<uint32_t> blocks;
+			std::vector<std::vector<uint32_t>> liveIn, liveOut;
+			ComputeLiveness(0, code.size(), isTemporary, ByteCode(VOID), blocks, liveIn, liveOut);
+			std::vector<uint32_t> insUses;
+			uint32_t insDef;
+			for (size_t b = 0; b < blocks.size(); ++b) {
+				uint32_t end = b + 1 < blocks.size()? blocks[b + 1] : code.size();
+				std::vector<uint32_t> members;
+				for (uint32_t i = blocks[b]; i < end; i = Next(i)) members.push_back(i);
+				std::unordered_set<uint32_t> live(liveOut[b].begin(), liveOut[b].end());
+				for (size_t m = members.size(); m-- > 0;) {
+					Instruction& ins = code[members[m]];
+					ByteCode op = Opcode(ins);
+					// OP tmp ... followed by SET var tmp becomes OP var ...
+					if (op == SET && OperandsCount(ins) == 2 && m > 0 && IsTemporary(Word(ins, 2)) && !live.contains(Word(ins, 2).rawValue)) {
+						ByteCode var = Word(ins, 1);
+						ByteCode tmp = Word(ins, 2);
+						Instruction& prev = code[members[m - 1]];
+						if (var.type == tmp.type && IsPureInstruction(prev) && Word(prev, 1).rawValue == tmp.rawValue) {
+							bool readsVar = false;
+							for (uint32_t o = 1, count = OperandsCount(prev); o <= count; ++o) {
+								if (Word(prev, o).rawValue == var.rawValue) readsVar = true;
+							}
+							if (!readsVar) {
+								Word(prev, 1) = var;
+								Remove(ins);
+								changed = true;
+								continue;
+							}
+						}
+					}
+					GetUsesAndDef(ins, isTemporary, insUses, insDef);
+					if (insDef != NONE && !live.contains(insDef) && IsRemovable(op) && IsPureInstruction(ins)) {
+						Remove(ins);
+						changed = true;
+						continue;
+					}
+					if (insDef != NONE) live.erase(insDef);
+					live.insert(insUses.begin(), insUses.end());
+				}
+			}
+			return changed;
+		}
+		
+		// Pass: within a basic block, a pure operation that was already computed and whose operands did not change since copies the previous result instead
+		bool EliminateCommonSubexpressions() {
+			bool changed = false;
+			FindLeaders();
+			std::vector<uint32_t> available {}; // instructions whose REF_DST still holds their result
+			for (uint32_t i = Resolve(0); i < code.size(); i = Next(i)) {
+				Instruction& ins = code[i];
+				if (ins.leader) available.clear();
+				ByteCode op = Opcode(ins);
+				if (!IsPureInstruction(ins)) {
+					if (op.type == OP) available.clear(); // calls, device functions, array mutators and everything else that may write variables
+					continue;
+				}
+				ByteCode dst = Word(ins, 1);
+				uint32_t count = OperandsCount(ins);
+				bool reusable = op != SET && (dst.type == RAM_VAR_NUMERIC || dst.type == RAM_VAR_TEXT);
+				for (uint32_t o = 2; o <= count; ++o) {
+					if (Word(ins, o).rawValue == dst.rawValue) reusable = false;
+				}
+				if (reusable) {
+					auto same = std::find_if(available.rbegin(), available.rend(), [&](uint32_t a){
+						const Instruction& prev = code[a];
+						if (Opcode(prev).rawValue != op.rawValue || OperandsCount(prev) != count || Word(prev, 1).type != dst.type) return false;
+						for (uint32_t o = 2; o <= count; ++o) {
+							if (Word(prev, o).rawValue != Word(ins, o).rawValue) return false;
+						}
+						return true;
+					});
+					if (same != available.rend()) {
+						changed = true;
+						ByteCode result = Word(code[*same], 1);
+						if (result.rawValue == dst.rawValue) {
+							Remove(ins);
+							continue;
+						}
+						Word(ins, 0) = SET;
+						Word(ins, 2) = result;
+						Word(ins, 3) = VOID;
+						ins.size = 4;
+						reusable = false;
+					}
+				}
+				std::erase_if(available, [&](uint32_t a){
+					for (uint32_t o = 1, n = OperandsCount(code[a]); o <= n; ++o) {
+						if (Word(code[a], o).rawValue == dst.rawValue) return true;
+					}
+					return false;
+				});
+				if (reusable) {
+					if (available.size() >= 32) available.erase(available.begin());
+					available.push_back(i);
+				}
+			}
+			return changed;
+		}
+		
+		// Pass: pure operations within a loop that do not depend on anything written by the loop are moved right before it, then the program is rebuilt
+		bool HoistLoopInvariants() {
+			FindLeaders();
+			std::vector<std::pair<uint32_t/*from*/, uint32_t/*to*/>> edges {};
+			std::map<uint32_t/*header*/, uint32_t/*latch*/> loops {};
+			for (uint32_t i = Resolve(0); i < code.size(); i = Next(i)) {
+				ByteCode op = Opcode(code[i]);
+				if (op != GTO && op != CND) continue;
+				for (uint32_t a = 1; a <= (op == CND? 2u : 1u); ++a) {
+					uint32_t target = Target(Word(code[i], a));
+					edges.emplace_back(i, target);
+					if (target <= i) loops[target] = std::max(loops[target], i);
+				}
+			}
+			if (loops.empty()) return false;
+			
+			auto isTemporary = [this](ByteCode ref){ return IsTemporary(ref); };
+			std::vector<uint32_t> blocks;
+			std::vector<std::vector<uint32_t>> liveIn, liveOut;
+			ComputeLiveness(0, code.size(), isTemporary, ByteCode(VOID), blocks, liveIn, liveOut);
+			auto liveAt = [&](uint32_t index, ByteCode ref){
+				auto b = std::upper_bound(blocks.begin(), blocks.end(), index);
+				if (b == blocks.begin()) return false;
+				const auto& live = liveIn[b - blocks.begin() - 1];
+				return std::binary_search(live.begin(), live.end(), ref.rawValue);
+			};
+			
+			std::unordered_map<uint32_t/*after*/, std::vector<uint32_t>> insertions {};
+			std::vector<std::pair<uint32_t, uint32_t>> changedLoops {};
+			for (auto [header, latch] : loops) {
+				// Nested loops are handled in the next round
+				if (std::any_of(changedLoops.begin(), changedLoops.end(), [&](auto range){ return header <= range.second && latch >= range.first; })) continue;
+				// The loop must only be entered by falling through its header
+				uint32_t prev = header;
+				while (prev > 0 && code[--prev].removed);
+				if (prev == header || code[prev].removed) continue;
+				ByteCode prevOp = Opcode(code[prev]);
+				if (prevOp == GTO || prevOp == CND || prevOp.type == RETURN) continue;
+				if (std::any_of(edges.begin(), edges.end(), [&](auto edge){ return (edge.first < header || edge.first > latch) && edge.second >= header && edge.second <= latch; })) continue;
+				if (std::any_of(roots.begin(), roots.end(), [&](uint32_t* addr){ uint32_t t = Target(ByteCode(ADDR, *addr)); return t >= header && t <= latch; })) continue;
+				uint32_t function = FunctionAt(code[header].addr);
+				if (function == NONE) continue;
+				
+				// Everything the loop may write, calls and device functions may write anything that is not a variable of this function
+				std::unordered_map<uint32_t/*rawValue*/, uint32_t/*writes*/> writes {};
+				bool writesGlobals = false, recursive = false;
+				std::vector<uint32_t> exits {};
+				for (uint32_t k = header; k <= latch; k = Next(k)) {
+					const Instruction& ins = code[k];
+					ByteCode op = Opcode(ins);
+					if (op == STR || op == RST) recursive = true;
+					if (op == JMP || op == DEV) writesGlobals = true;
+					if (IsPureInstruction(ins)) {
+						++writes[Word(ins, 1).rawValue];
+					} else if (op.type == OP && op != GTO && op != CND) {
+						for (uint32_t o = 1, count = OperandsCount(ins); o <= count; ++o) ++writes[Word(ins, o).rawValue];
+					}
+				}
+				if (recursive) continue;
+				for (auto [from, to] : edges) {
+					if (from >= header && from <= latch && (to < header || to > latch)) exits.push_back(to);
+				}
+				const Function& f = functions[function];
+				auto isInvariant = [&](ByteCode ref){
+					switch (ref.type) {
+						case ROM_CONST_NUMERIC: case ROM_CONST_TEXT: case ARRAY_INDEX: case OBJ_KEY: case VOID: return true;
+						default: break;
+					}
+					if (writes.contains(ref.rawValue)) return false;
+					return !writesGlobals || Owns(f, ref);
+				};
+				
+				// Operations that depend on hoisted ones are hoisted after them
+				std::vector<uint32_t>* hoisted = nullptr;
+				for (bool again = true; again;) {
+					again = false;
+					for (uint32_t k = header; k <= latch; k = Next(k)) {
+						const Instruction& ins = code[k];
+						if (!IsPureInstruction(ins) || !IsHoistable(Opcode(ins))) continue;
+						ByteCode dst = Word(ins, 1);
+						if (!IsTemporary(dst) || writes[dst.rawValue] != 1 || liveAt(header, dst)) continue;
+						bool invariant = true;
+						for (uint32_t o = 2, count = OperandsCount(ins); o <= count; ++o) {
+							if (Word(ins, o).rawValue == dst.rawValue || !isInvariant(Word(ins, o))) invariant = false;
+						}
+						if (!invariant || std::any_of(exits.begin(), exits.end(), [&](uint32_t e){ return liveAt(e, dst); })) continue;
+						if (!hoisted) hoisted = &insertions[prev];
+						hoisted->push_back(k);
+						writes.erase(dst.rawValue);
+						Remove(code[k]);
+						again = true;
+					}
+				}
+				if (hoisted) changedLoops.emplace_back(header, latch);
+			}
+			if (insertions.empty()) return false;
+			Rebuild({}, insertions);
+			return true;
+		}
+		
+		void Simplify(int level) {
+			for (int iteration = 0; iteration < 8; ++iteration) {
+				bool changed = FoldConstants();
+				if (level >= 2) {
+					changed |= PropagateCopies();
+					changed |= FoldConstants();
+					changed |= EliminateCommonSubexpressions();
+					changed |= EliminateDeadStores();
+				}
+				changed |= ThreadJumps();
+				changed |= RemoveUnreachable();
+				if (!changed) break;
+			}
+		}
+		
+		// A call replaced by a copy of the body of the function, with some of its variables remapped to temporaries of the caller
+		struct Expansion {
+			uint32_t first; // instructions [first, last) of the function
+			uint32_t last;
+			std::unordered_map<uint32_t/*rawValue*/, ByteCode> slots {};
+		};
+		
+		// Variables of the function, including the ones of the functions inlined into it
+		static bool Owns(const Function& function, ByteCode ref) {
+			if (ref.type != RAM_VAR_NUMERIC && ref.type != RAM_VAR_TEXT) return false;
+			const uint32_t* range = ref.type == RAM_VAR_NUMERIC? function.numericVariables : function.textVariables;
+			const auto& pool = function.pool[ref.type == RAM_VAR_NUMERIC? 0 : 1];
+			return (ref.value >= range[0] && ref.value < range[1]) || std::any_of(pool.begin(), pool.end(), [ref](ByteCode tmp){ return tmp.rawValue == ref.rawValue; });
+		}
+		
+		// Index in functions of the one containing the given address, NONE if none
+		uint32_t FunctionAt(uint32_t addr) const {
+			auto it = std::upper_bound(functions.begin(), functions.end(), addr, [](uint32_t a, const Function& f){ return a < f.addr; });
+			if (it == functions.begin() || addr >= std::prev(it)->end) return NONE;
+			return uint32_t(std::prev(it) - functions.begin());
+		}
+		
+		// Pass: calls to small non-recursive functions that do not call anything are replaced by a copy of their body, then the program is rebuilt
+		bool InlineFunctions() {
+			FindLeaders();
+			std::unordered_map<uint32_t/*first*/, uint32_t/*function*/> candidates {};
+			for (uint32_t f = 0; f < functions.size(); ++f) {
+				if (functions[f].recursive) continue;
+				uint32_t first = Target(ByteCode(ADDR, functions[f].addr));
+				uint32_t last = Target(ByteCode(ADDR, functions[f].end));
+				uint32_t count = 0, lastInstruction = NONE;
+				bool inlinable = first < last;
+				for (uint32_t i = first; i < last && inlinable; i = Next(i)) {
+					ByteCode op = Opcode(code[i]);
+					if (op == JMP || op == STR || op == RST) inlinable = false;
+					if (op == GTO || op == CND) {
+						for (uint32_t a = 1; a <= (op == CND? 2u : 1u); ++a) {
+							uint32_t target = Target(Word(code[i], a));
+							if (target < first || target >= last) inlinable = false;
+						}
+					}
+					if (op.type == OP) ++count;
+					lastInstruction = i;
+				}
+				// The copy must not fall through past its end
+				if (inlinable && count <= XC_INLINE_MAX_INSTRUCTIONS && (Opcode(code[lastInstruction]).type == RETURN || Opcode(code[lastInstruction]) == GTO)) {
+					candidates.emplace(first, f);
+				}
+			}
+			if (candidates.empty()) return false;
+			
+			// Calls, with the arguments set right before them and the instructions that may read the return value right after them
+			struct Site {
+				uint32_t jmp;
+				uint32_t function;
+				uint32_t block; // leader of the basic block
+				std::vector<uint32_t> args {}; // instructions that write the arguments
+				std::vector<uint32_t> reads {}; // instructions that read the return value
+			};
+			std::vector<Site> sites {};
+			std::unordered_set<uint32_t> withMissingArgs {}; // functions that may read arguments from a previous call
+			std::unordered_map<uint32_t/*function*/, uint32_t> unexpectedReads {}; // of the return value, elsewhere than right after a call
+			for (auto [first, f] : candidates) {
+				ByteCode ret = functions[f].returnVar;
+				if (ret.type == VOID) continue;
+				uint32_t last = Target(ByteCode(ADDR, functions[f].end));
+				for (uint32_t i = Resolve(0); i < code.size(); i = Next(i)) {
+					if (i == first) i = last;
+					if (i >= code.size()) break;
+					for (uint32_t o = 1, count = OperandsCount(code[i]); o <= count; ++o) {
+						if (Word(code[i], o).rawValue == ret.rawValue) ++unexpectedReads[f];
+					}
+				}
+			}
+			uint32_t block = NONE;
+			for (uint32_t i = Resolve(0); i < code.size(); i = Next(i)) {
+				if (code[i].leader) block = i;
+				if (Opcode(code[i]) != JMP) continue;
+				auto candidate = candidates.find(Target(Word(code[i], 1)));
+				if (candidate == candidates.end()) continue;
+				const Function& function = functions[candidate->second];
+				Site site {i, candidate->second, block};
+				auto isParam = [&function](ByteCode ref){
+					return std::any_of(function.params.begin(), function.params.end(), [ref](ByteCode param){ return param.rawValue == ref.rawValue; });
+				};
+				std::unordered_set<uint32_t> set {};
+				if (!code[i].leader) {
+					for (uint32_t k = i; k-- > 0;) {
+						if (code[k].removed) continue;
+						if (!IsPureInstruction(code[k]) || !isParam(Word(code[k], 1)) || set.contains(Word(code[k], 1).rawValue)) break;
+						site.args.push_back(k);
+						set.insert(Word(code[k], 1).rawValue);
+						if (code[k].leader) break;
+					}
+				}
+				for (ByteCode param : function.params) {
+					if ((param.type == RAM_VAR_NUMERIC || param.type == RAM_VAR_TEXT) && !set.contains(param.rawValue)) withMissingArgs.insert(candidate->second);
+				}
+				if (function.returnVar.type != VOID) {
+					for (uint32_t k = Next(i); k < code.size() && !code[k].leader && Opcode(code[k]) != JMP; k = Next(k)) {
+						bool reads = false;
+						for (uint32_t o = 1, count = OperandsCount(code[k]); o <= count; ++o) {
+							if (Word(code[k], o).rawValue == function.returnVar.rawValue) reads = true;
+						}
+						if (reads) {
+							site.reads.push_back(k);
+							--unexpectedReads[candidate->second];
+						}
+						ByteCode op = Opcode(code[k]);
+						if (op == GTO || op == CND || op.type == RETURN) break;
+					}
+				}
+				if (FunctionAt(code[i].addr) != NONE) sites.push_back(std::move(site));
+			}
+			
+			std::unordered_map<uint32_t/*jmp*/, Expansion> expansions {};
+			std::unordered_map<uint32_t/*function*/, std::vector<uint32_t>> liveAtEntry {};
+			// Sites within the same basic block use distinct temporaries, since their lifetimes may overlap, and temporaries are never reused across rounds
+			struct PoolUse {
+				size_t base[2] {}; // pool sizes before this round
+				size_t next[2] {};
+				uint32_t block = NONE;
+			};
+			std::unordered_map<uint32_t/*caller*/, PoolUse> pools {};
+			uint64_t size = program.size();
+			for (const Site& site : sites) {
+				const Function& callee = functions[site.function];
+				uint32_t callerIndex = FunctionAt(code[site.jmp].addr);
+				Function& caller = functions[callerIndex];
+				Expansion expansion {Target(ByteCode(ADDR, callee.addr)), Target(ByteCode(ADDR, callee.end))};
+				uint64_t added = 0;
+				for (uint32_t i = expansion.first; i < expansion.last; i = Next(i)) added += code[i].size;
+				if (size + added > XC_MAX_ROM_SIZE / 2) continue;
+				size += added;
+				
+				auto owned = [this, &callee](ByteCode ref){ return Owns(callee, ref); };
+				auto [live, computed] = liveAtEntry.try_emplace(site.function);
+				if (computed) {
+					std::vector<uint32_t> blocks;
+					std::vector<std::vector<uint32_t>> liveIn, liveOut;
+					ComputeLiveness(expansion.first, expansion.last, owned, callee.returnVar, blocks, liveIn, liveOut);
+					if (!blocks.empty()) live->second = liveIn[0];
+				}
+				auto isLive = [&live](ByteCode ref){ return std::binary_search(live->second.begin(), live->second.end(), ref.rawValue); };
+				
+				// Variables of the callee, in order of appearance
+				std::vector<ByteCode> variables {};
+				auto appear = [&](ByteCode ref){
+					if (owned(ref) && std::none_of(variables.begin(), variables.end(), [ref](ByteCode v){ return v.rawValue == ref.rawValue; })) variables.push_back(ref);
+				};
+				for (uint32_t k : site.args) appear(Word(code[k], 1));
+				for (uint32_t i = expansion.first; i < expansion.last; i = Next(i)) {
+					for (uint32_t o = 1, count = OperandsCount(code[i]); o <= count; ++o) appear(Word(code[i], o));
+				}
+				
+				auto [pool, newCaller] = pools.try_emplace(callerIndex, PoolUse{{caller.pool[0].size(), caller.pool[1].size()}});
+				size_t* next = pool->second.next;
+				if (newCaller || pool->second.block != site.block) {
+					pool->second.block = site.block;
+					next[0] = pool->second.base[0];
+					next[1] = pool->second.base[1];
+				}
+				for (ByteCode ref : variables) {
+					if (ref.rawValue == callee.returnVar.rawValue) {
+						if (isLive(ref) || unexpectedReads[site.function] != 0) continue;
+					} else if (isLive(ref)) {
+						bool isArg = std::any_of(site.args.begin(), site.args.end(), [&](uint32_t k){ return Word(code[k], 1).rawValue == ref.rawValue; });
+						if (!isArg || withMissingArgs.contains(site.function)) continue;
+					}
+					int t = ref.type == RAM_VAR_NUMERIC? 0 : 1;
+					if (next[t] == caller.pool[t].size()) {
+						ByteCode tmp(ref.type, t == 0? ramNumericVariables++ : ramTextVariables++);
+						caller.pool[t].push_back(tmp);
+						AddTemporary(tmp);
+					}
+					expansion.slots.emplace(ref.rawValue, caller.pool[t][next[t]++]);
+				}
+				
+				// The caller now sets the arguments and reads the return value in its own temporaries
+				for (uint32_t k : site.args) {
+					if (auto slot = expansion.slots.find(Word(code[k], 1).rawValue); slot != expansion.slots.end()) Word(code[k], 1) = slot->second;
+				}
+				if (auto slot = expansion.slots.find(callee.returnVar.rawValue); slot != expansion.slots.end()) {
+					for (uint32_t k : site.reads) {
+						for (uint32_t o = 1, count = OperandsCount(code[k]); o <= count; ++o) {
+							if (Word(code[k], o).rawValue == callee.returnVar.rawValue) Word(code[k], o) = slot->second;
+						}
+					}
+				}
+				expansions.emplace(site.jmp, std::move(expansion));
+			}
+			if (expansions.empty()) return false;
+			Rebuild(expansions);
+			return true;
+		}
+		
+		// Pass: calls with constant arguments to functions that only compute a value from them are run at compile time, within XC_EVALUATE_MAX_INSTRUCTIONS,
+		// then the call is removed and its value is read as a constant right after it
+		bool EvaluateCalls() {
+			FindLeaders();
+			std::unordered_map<uint32_t/*first*/, uint32_t/*function*/> entries {};
+			std::unordered_map<uint32_t/*returnVar*/, uint32_t/*function*/> returnVars {};
+			for (uint32_t f = 0; f < functions.size(); ++f) {
+				if (functions[f].recursive) continue;
+				uint32_t first = Target(ByteCode(ADDR, functions[f].addr));
+				if (first < Target(ByteCode(ADDR, functions[f].end))) entries.emplace(first, f);
+				if (functions[f].returnVar.type != VOID) returnVars.emplace(functions[f].returnVar.rawValue, f);
+			}
+			if (entries.empty()) return false;
+			auto isParam = [this](uint32_t f, ByteCode ref){
+				return std::any_of(functions[f].params.begin(), functions[f].params.end(), [ref](ByteCode param){ return param.rawValue == ref.rawValue; });
+			};
+			
+			// Calls, with the constant arguments set right before them and the instructions that read the return value right after them
+			struct Site {
+				uint32_t jmp;
+				uint32_t function;
+				std::vector<std::pair<ByteCode/*param*/, ByteCode/*constant*/>> args {};
+				std::vector<uint32_t> reads {};
+			};
+			std::vector<Site> sites {};
+			std::unordered_map<uint32_t/*function*/, int> unexpectedReads {}; // of the return value, elsewhere than right after a call
+			for (uint32_t i = Resolve(0); i < code.size(); i = Next(i)) {
+				for (uint32_t o = 1, count = OperandsCount(code[i]); o <= count; ++o) {
+					auto ret = returnVars.find(Word(code[i], o).rawValue);
+					if (ret != returnVars.end() && FunctionAt(code[i].addr) != ret->second) ++unexpectedReads[ret->second];
+				}
+				if (Opcode(code[i]) != JMP) continue;
+				auto entry = entries.find(Target(Word(code[i], 1)));
+				if (entry == entries.end()) continue;
+				const Function& function = functions[entry->second];
+				Site& site = sites.emplace_back(Site{i, entry->second});
+				if (!code[i].leader) {
+					for (uint32_t k = i; k-- > 0;) {
+						if (code[k].removed) continue;
+						if (!IsPureInstruction(code[k]) || !isParam(site.function, Word(code[k], 1))) break;
+						ByteCode param = Word(code[k], 1);
+						if (std::none_of(site.args.begin(), site.args.end(), [param](const auto& arg){ return arg.first.rawValue == param.rawValue; })) {
+							ByteCode value = OperandsCount(code[k]) == 2 && Opcode(code[k]) == SET? Word(code[k], 2) : ByteCode{};
+							site.args.emplace_back(param, (value.type == ROM_CONST_NUMERIC || value.type == ROM_CONST_TEXT)? value : ByteCode(VOID));
+						}
+						if (code[k].leader) break;
+					}
+				}
+				if (function.returnVar.type != VOID) {
+					for (uint32_t k = Next(i); k < code.size() && !code[k].leader && Opcode(code[k]) != JMP; k = Next(k)) {
+						for (uint32_t o = 1, count = OperandsCount(code[k]); o <= count; ++o) {
+							if (Word(code[k], o).rawValue == function.returnVar.rawValue) {
+								if (site.reads.empty() || site.reads.back() != k) site.reads.push_back(k);
+								--unexpectedReads[site.function];
+							}
+						}
+						ByteCode op = Opcode(code[k]);
+						if (op == GTO || op == CND || op.type == RETURN) break;
+					}
+				}
+			}
+			
+			// Only the parameters may be read before being written, so that a call leaves nothing behind for the next ones
+			std::unordered_map<uint32_t/*function*/, bool> evaluable {};
+			auto isEvaluable = [&](uint32_t f) {
+				auto [it, computed] = evaluable.try_emplace(f, false);
+				if (computed) {
+					const Function& function = functions[f];
+					std::vector<uint32_t> blocks;
+					std::vector<std::vector<uint32_t>> liveIn, liveOut;
+					ComputeLiveness(Target(ByteCode(ADDR, function.addr)), Target(ByteCode(ADDR, function.end)), [&function](ByteCode ref){ return Owns(function, ref); }, function.returnVar, blocks, liveIn, liveOut);
+					it->second = !blocks.empty() && std::all_of(liveIn[0].begin(), liveIn[0].end(), [&](uint32_t ref){ return isParam(f, ByteCode{ref}); });
+				}
+				return it->second;
+			};
+			
+			// Runs the function on its own variables only, the result is a constant (VOID when it does not return a value), false if it cannot be evaluated
+			struct Value {
+				bool text = false;
+				double number = 0;
+				std::string str {};
+			};
+			auto evaluate = [&](const Site& site, ByteCode& result) -> bool {
+				const Function& function = functions[site.function];
+				const uint32_t first = Target(ByteCode(ADDR, function.addr)), last = Target(ByteCode(ADDR, function.end));
+				std::unordered_map<uint32_t/*rawValue*/, Value> variables {};
+				for (auto [param, constant] : site.args) {
+					if (constant.type == ROM_CONST_NUMERIC && param.type == RAM_VAR_NUMERIC) variables[param.rawValue] = {false, numericConstants[constant.value]};
+					else if (constant.type == ROM_CONST_TEXT && param.type == RAM_VAR_TEXT) variables[param.rawValue] = {true, 0, textConstants[constant.value]};
+				}
+				auto read = [&](ByteCode ref, Value& value) {
+					if (ref.type == ROM_CONST_NUMERIC) value = {false, numericConstants[ref.value]};
+					else if (ref.type == ROM_CONST_TEXT) value = {true, 0, textConstants[ref.value]};
+					else if (auto it = variables.find(ref.rawValue); it != variables.end() && Owns(function, ref)) value = it->second;
+					else return false;
+					return true;
+				};
+				auto writable = [&](ByteCode ref){ return Owns(function, ref) && !isParam(site.function, ref); };
+				uint32_t i = first;
+				for (int budget = XC_EVALUATE_MAX_INSTRUCTIONS; budget > 0 && i < last; --budget) {
+					const Instruction& ins = code[i];
+					ByteCode op = Opcode(ins);
+					uint32_t count = OperandsCount(ins);
+					Value a, b;
+					if (op.type == RETURN) {
+						if (function.returnVar.type == VOID) {
+							result = VOID;
+							return true;
+						}
+						if (!read(function.returnVar, a)) return false;
+						if (a.text) {
+							result = ByteCode(ROM_CONST_TEXT, AddTextConstant(a.str));
+						} else {
+							if (!IsWritableExactly(a.number)) return false;
+							result = ByteCode(ROM_CONST_NUMERIC, AddNumericConstant(a.number));
+						}
+						return true;
+					} else if (op == GTO) {
+						i = Target(Word(ins, 1));
+						if (i < first) return false;
+						continue;
+					} else if (op == CND) {
+						if (count != 3 || !read(Word(ins, 3), a)) return false;
+						bool value = a.text? (a.str != "" && a.str != "0") : std::abs(a.number) > EPSILON_DOUBLE;
+						i = Target(Word(ins, value? 1 : 2));
+						if (i < first) return false;
+						continue;
+					} else if ((op == INC || op == DEC) && count == 1) {
+						auto it = variables.find(Word(ins, 1).rawValue);
+						if (!writable(Word(ins, 1)) || it == variables.end() || it->second.text) return false;
+						it->second.number = std::nearbyint(it->second.number) + (op == INC? 1.0 : -1.0);
+					} else if (IsPureInstruction(ins)) {
+						ByteCode dst = Word(ins, 1);
+						if (!writable(dst)) return false;
+						if (count >= 2 && !read(Word(ins, 2), a)) return false;
+						if (count >= 3 && !read(Word(ins, 3), b)) return false;
+						Value value;
+						if (dst.type == RAM_VAR_TEXT) {
+							if (op == SET && count == 2 && a.text) value = a;
+							else if (op == CCT && count == 3 && a.text && b.text && a.str.length() + b.str.length() <= XC_MAX_TEXT_LENGTH) value = {true, 0, a.str + b.str};
+							else return false;
+						} else {
+							if (count > 3 || a.text || b.text) return false;
+							if (op == SET && count == 1) value.number = 0;
+							else if (count == 1 || op == CCT || !Evaluate(op, count - 1, a.number, b.number, value.number)) return false;
+						}
+						variables[dst.rawValue] = std::move(value);
+					} else {
+						return false;
+					}
+					i = Next(i);
+				}
+				return false;
+			};
+			
+			bool changed = false;
+			std::map<std::pair<uint32_t/*function*/, std::vector<uint64_t>/*args*/>, ByteCode/*result*/> evaluated {}; // VOID result when it could not be evaluated
+			for (const Site& site : sites) {
+				const Function& function = functions[site.function];
+				if ((function.returnVar.type != VOID && unexpectedReads[site.function] != 0) || !isEvaluable(site.function)) continue;
+				std::vector<uint64_t> args {};
+				for (auto [param, constant] : site.args) args.push_back(uint64_t(param.rawValue) << 32 | constant.rawValue);
+				std::sort(args.begin(), args.end());
+				auto [it, inserted] = evaluated.try_emplace({site.function, args}, ByteCode(VOID));
+				if (inserted) {
+					ByteCode result;
+					if (evaluate(site, result)) it->second = function.returnVar.type == VOID? ByteCode(ADDR) : result;
+				}
+				ByteCode result = it->second;
+				if (result.type == VOID) continue;
+				// The return value may only be read as a value
+				bool readable = true;
+				for (uint32_t k : site.reads) {
+					ByteCode op = Opcode(code[k]);
+					bool pure = IsPureInstruction(code[k]);
+					for (uint32_t o = 1, count = OperandsCount(code[k]); o <= count; ++o) {
+						if (Word(code[k], o).rawValue != function.returnVar.rawValue) continue;
+						bool value = (pure && o >= 2 && !(op == IDX && o == 2 && result.type == ROM_CONST_TEXT)) || (op == CND && o == 3) || op == OUT;
+						if (!value) readable = false;
+					}
+				}
+				if (!readable) continue;
+				for (uint32_t k : site.reads) {
+					for (uint32_t o = 1, count = OperandsCount(code[k]); o <= count; ++o) {
+						if (Word(code[k], o).rawValue == function.returnVar.rawValue) Word(code[k], o) = result;
+					}
+				}
+				Remove(code[site.jmp]);
+				changed = true;
+			}
+			return changed;
+		}
+		
+		// Compact the program, expand inlined calls, insert the instructions moved out of loops and remap all addresses
+		void Rebuild(const std::unordered_map<uint32_t/*jmp*/, Expansion>& expansions = {}, const std::unordered_map<uint32_t/*after*/, std::vector<uint32_t>>& insertions = {}) {
+			std::vector<uint32_t> newAddr(code.size() + 1);
+			std::vector<ByteCode> optimized;
+			optimized.reserve(program.size());
+			struct Copy {
+				uint32_t jmp;
+				const Expansion* expansion;
+				uint32_t start, end;
+				std::vector<uint32_t> addr; // of each instruction of the function within the copy
+			};
+			std::vector<Copy> copies {};
+			std::vector<std::pair<uint32_t/*word*/, uint32_t/*instruction*/>> continuations {}; // gotos from within copies to the instruction that follows the call
+			for (uint32_t i = 0; i < code.size(); ++i) {
+				newAddr[i] = optimized.size();
+				if (code[i].removed) continue;
+				auto expansion = expansions.find(i);
+				if (expansion == expansions.end()) {
+					optimized.insert(optimized.end(), program.begin() + code[i].addr, program.begin() + code[i].addr + code[i].size);
+					// Instructions moved out of a loop, that do not contain any address
+					if (auto moved = insertions.find(i); moved != insertions.end()) {
+						for (uint32_t m : moved->second) {
+							optimized.insert(optimized.end(), program.begin() + code[m].addr, program.begin() + code[m].addr + code[m].size);
+						}
+					}
+					continue;
+				}
+				const Expansion& e = expansion->second;
+				Copy copy {i, &e, uint32_t(optimized.size()), 0, std::vector<uint32_t>(e.last - e.first)};
+				std::vector<std::pair<uint32_t/*word*/, uint32_t/*instruction*/>> jumps {};
+				uint32_t lastInstruction = e.first;
+				for (uint32_t c = Resolve(e.first); c < e.last; c = Next(c)) lastInstruction = c;
+				for (uint32_t c = e.first; c < e.last; ++c) {
+					copy.addr[c - e.first] = optimized.size();
+					if (code[c].removed) continue;
+					ByteCode op = Opcode(code[c]);
+					if (op.type == RETURN) {
+						if (c == lastInstruction) continue; // falls through
+						continuations.emplace_back(optimized.size() + 1, i + 1);
+						optimized.insert(optimized.end(), {GTO, ByteCode(ADDR, 0), VOID});
+						continue;
+					}
+					uint32_t at = optimized.size();
+					optimized.insert(optimized.end(), program.begin() + code[c].addr, program.begin() + code[c].addr + code[c].size);
+					if (op == GTO || op == CND) {
+						for (uint32_t a = 1; a <= (op == CND? 2u : 1u); ++a) jumps.emplace_back(at + a, Target(Word(code[c], a)));
+					}
+					for (uint32_t o = 1, count = OperandsCount(code[c]); o <= count; ++o) {
+						ByteCode& ref = optimized[at + o];
+						if (ref.type != RAM_VAR_NUMERIC && ref.type != RAM_VAR_TEXT) continue;
+						if (auto slot = e.slots.find(ref.rawValue); slot != e.slots.end()) ref = slot->second;
+					}
+				}
+				copy.end = optimized.size();
+				for (auto [word, target] : jumps) {
+					optimized[word].value = target < e.last? copy.addr[target - e.first] : copy.end;
+				}
+				copies.push_back(std::move(copy));
+			}
+			newAddr[code.size()] = optimized.size();
+			for (auto [word, instruction] : continuations) {
+				optimized[word].value = newAddr[instruction];
+			}
+			// Removed instructions continue at the next one, which is where newAddr already points
+			auto remap = [&](uint32_t addr) -> uint32_t {
+				if (addr >= program.size()) return optimized.size();
+				while (instructionAt[addr] == NONE) ++addr; // debug info may point within an instruction
+				return newAddr[instructionAt[addr]];
+			};
+			for (uint32_t i = 0; i < code.size(); ++i) {
+				if (code[i].removed || expansions.contains(i)) continue;
+				ByteCode op = Opcode(code[i]);
+				if (op == JMP || op == GTO || op == CND) {
+					for (uint32_t a = 1; a <= (op == CND? 2u : 1u); ++a) {
+						optimized[newAddr[i] + a].value = remap(Word(code[i], a).value);
+					}
+				}
+			}
+			for (uint32_t* addr : roots) {
+				*addr = remap(*addr);
+			}
+			for (Function& function : functions) {
+				function.addr = remap(function.addr);
+				function.end = remap(function.end);
+			}
+			// Calls inlined into a copied function are copied along with it, then each copy is an inlined call of its own
+			auto addrInCopy = [&](const Copy& copy, uint32_t addr) -> uint32_t {
+				while (instructionAt[addr] == NONE) ++addr;
+				uint32_t instruction = instructionAt[addr];
+				return instruction < copy.expansion->last? copy.addr[instruction - copy.expansion->first] : copy.end;
+			};
+			std::vector<DebugInfo::InlinedCall> inlinedCalls;
+			for (const DebugInfo::InlinedCall& call : debug.inlinedCalls) {
+				uint32_t begin = remap(call.begin), end = remap(call.end);
+				if (begin < end) inlinedCalls.push_back({begin, end, call.line, call.sourceFile});
+			}
+			for (const Copy& copy : copies) {
+				const Expansion& e = *copy.expansion;
+				uint32_t at = code[copy.jmp].addr;
+				uint32_t line = DebugInfo::Find(debug.lines, at);
+				if (copy.start < copy.end) inlinedCalls.push_back({copy.start, copy.end, line == NONE? 0 : line, DebugInfo::Find(debug.files, at)});
+				for (const DebugInfo::InlinedCall& call : debug.inlinedCalls) {
+					if (call.begin < AddrOf(e.first) || call.end > AddrOf(e.last)) continue;
+					uint32_t begin = addrInCopy(copy, call.begin), end = addrInCopy(copy, call.end);
+					if (begin < end) inlinedCalls.push_back({begin, end, call.line, call.sourceFile});
+				}
+			}
+			std::stable_sort(inlinedCalls.begin(), inlinedCalls.end(), [](const auto& a, const auto& b){ return a.begin != b.begin? a.begin < b.begin : a.end > b.end; });
+			debug.inlinedCalls.swap(inlinedCalls);
+			for (auto* entries : {&debug.lines, &debug.files}) {
+				auto valueAt = [entries](uint32_t addr){ return DebugInfo::Find(*entries, addr); };
+				// Within a copy the lines of the function are reported, and the ones of the caller again after it
+				std::vector<std::tuple<uint32_t/*addr*/, int/*priority*/, uint32_t/*value*/>> sorted;
+				for (auto [addr, value] : *entries) {
+					sorted.emplace_back(remap(addr), 1, value);
+				}
+				for (const Copy& copy : copies) {
+					const Expansion& e = *copy.expansion;
+					if (uint32_t value = valueAt(AddrOf(e.first)); value != NONE) sorted.emplace_back(copy.start, 2, value);
+					auto begin = std::lower_bound(entries->begin(), entries->end(), AddrOf(e.first), [](const std::pair<uint32_t, uint32_t>& entry, uint32_t a){ return entry.first < a; });
+					for (auto it = begin; it != entries->end() && it->first < AddrOf(e.last); ++it) {
+						uint32_t addr = it->first;
+						while (instructionAt[addr] == NONE) ++addr;
+						uint32_t at = instructionAt[addr] < e.last? copy.addr[instructionAt[addr] - e.first] : copy.end;
+						if (at < copy.end) sorted.emplace_back(at, 2, it->second);
+					}
+					if (uint32_t value = valueAt(code[copy.jmp].addr + code[copy.jmp].size - 1); value != NONE) sorted.emplace_back(copy.end, 0, value);
+				}
+				std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b){ return std::get<0>(a) != std::get<0>(b)? std::get<0>(a) < std::get<0>(b) : std::get<1>(a) < std::get<1>(b); });
+				std::vector<std::pair<uint32_t, uint32_t>> remapped;
+				for (auto [addr, priority, value] : sorted) {
+					if (!remapped.empty() && remapped.back().first == addr) remapped.back().second = value;
+					else remapped.emplace_back(addr, value);
+				}
+				entries->swap(remapped);
+			}
+			program.swap(optimized);
+		}
+		
+	public:
+		Optimizer(std::vector<ByteCode>& program_, std::vector<double>& numericConstants_, std::vector<std::string>& textConstants_, DebugInfo& debug_, uint32_t& ramNumericVariables_, uint32_t& ramTextVariables_)
+		: program(program_), numericConstants(numericConstants_), textConstants(textConstants_), debug(debug_), ramNumericVariables(ramNumericVariables_), ramTextVariables(ramTextVariables_) {
+			for (uint32_t i = 0; i < numericConstants.size(); ++i) numericConstantsIndex.try_emplace(std::bit_cast<uint64_t>(numericConstants[i]), i);
+			for (uint32_t i = 0; i < textConstants.size(); ++i) textConstantsIndex.try_emplace(textConstants[i], i);
 		}
-		return false;
-	}
-
-	inline static bool IsStorage(ByteCode v) {
-		switch (v.type) {
-			case STORAGE_ARRAY_NUMERIC:
-			case STORAGE_ARRAY_TEXT:
-			case STORAGE_VAR_NUMERIC:
-			case STORAGE_VAR_TEXT:
-			return true;
+		
+		// The given address will be remapped, and the code it points to is kept
+		void AddRoot(uint32_t& addr) {
+			roots.push_back(&addr);
+		}
+		
+		void AddTemporary(ByteCode tmp) {
+			temporaries.insert(tmp.rawValue);
+		}
+		
+		// Functions must be added in the order they were compiled
+		void AddFunction(const Function& function) {
+			functions.push_back(function);
+		}
+		
+		// In the order they were added, with their addresses remapped once the optimizer ran
+		const std::vector<Function>& GetFunctions() const {
+			return functions;
+		}
+		
+		void Run(int level) {
+			if (level <= 0 || !Decode()) return;
+			Simplify(1);
+			if (level >= 2) {
+				// Functions that become small enough once their own calls are inlined may be inlined in the next round
+				for (int round = 0; round < 3; ++round) {
+					if (!InlineFunctions() || !Decode()) break;
+				}
+				Simplify(level);
+				if (EvaluateCalls()) Simplify(level);
+				// Invariants of nested loops are moved out one loop per round
+				for (int round = 0; round < 3; ++round) {
+					if (!HoistLoopInvariants() || !Decode()) break;
+					Simplify(level);
+				}
+			}
+			Rebuild();
 		}
-		return false;
-	}
-	
-	// Does not include arrays
-	inline static bool IsNumeric(ByteCode v) noexcept {
-		// Fast path for most common case: RAM variable (type 70)
-		// Types: ROM_CONST_NUMERIC=40, STORAGE_VAR_NUMERIC=50, RAM_VAR_NUMERIC=70
-		return v.type == RAM_VAR_NUMERIC || v.type == ROM_CONST_NUMERIC || v.type == STORAGE_VAR_NUMERIC;
-	}
-
-	// Does not include arrays
-	inline static bool IsText(ByteCode v) noexcept {
-		// Types: ROM_CONST_TEXT=41, STORAGE_VAR_TEXT=51, RAM_VAR_TEXT=71
-		return v.type == RAM_VAR_TEXT || v.type == ROM_CONST_TEXT || v.type == STORAGE_VAR_TEXT;
-	}
-
-	inline static bool IsObject(ByteCode v) noexcept {
-		return v.type >= RAM_OBJECT;
-	}
-
-	struct TimerFunction {
-		double interval;
-		uint32_t addr;
-	};
-
-	struct InputFunction {
-		uint32_t addr = 0;
-		std::vector<uint32_t> args {};
-	};
-	
-	struct EntryPoint {
-		std::string name;
-		uint32_t addr = 0;
-		ByteCode ref = VOID;
-		std::vector<uint32_t> args {};
 	};
 
 	class Assembly {
@@ -2814,23 +4822,157 @@ const int VERSION_PATCH = 0;
 		static inline const uint32_t parserVersionMajor = VERSION_MAJOR;
 		static inline const uint32_t parserVersionMinor = VERSION_MINOR;
 		
-		static inline std::string GetDeviceObjectsList() {
+		std::string GetDeviceObjectsList() const {
 			std::string str{"OBJ"};
-			for (const auto& name : Device::objectTypesList) {
+			for (const auto& name : context->objectTypesList) {
 				str += ' ' + name;
 			}
 			return str;
 		}
 		
-		static inline std::string GetDeviceFunctionsList(uint8_t base) {
+		std::string GetDeviceFunctionsList(uint8_t base) const {
 			std::string str{"FN"};
-			for (const auto& name : Device::deviceFunctionsList[base]) {
+			for (const auto& name : context->GetFunctionKeys(base)) {
 				str += ' ' + name;
 			}
 			return str;
 		}
 		
+		// Tree shaking, once the program is optimized: RAM variables and ROM constants that are not referenced anymore are dropped and the remaining ones renumbered.
+		// The initialization of unused global variables is removed from vars_init, storage and object references are left untouched.
+		void RemoveUnusedVariablesAndConstants(SymbolTable& userVars) {
+			enum Kind {NUMERIC_VAR, TEXT_VAR, NUMERIC_ARRAY, TEXT_ARRAY, NUMERIC_CONST, TEXT_CONST, KIND_COUNT, NO_KIND = KIND_COUNT};
+			auto kindOf = [](uint8_t type) -> Kind {
+				switch (type) {
+					case RAM_VAR_NUMERIC: return NUMERIC_VAR;
+					case RAM_VAR_TEXT: return TEXT_VAR;
+					case RAM_ARRAY_NUMERIC: return NUMERIC_ARRAY;
+					case RAM_ARRAY_TEXT: return TEXT_ARRAY;
+					case ROM_CONST_NUMERIC: return NUMERIC_CONST;
+					case ROM_CONST_TEXT: return TEXT_CONST;
+					default: return NO_KIND;
+				}
+			};
+			uint32_t* counts[KIND_COUNT] = {&ram_numericVariables, &ram_textVariables, &ram_numericArrays, &ram_textArrays, nullptr, nullptr};
+			uint32_t numericConstantsCount = rom_numericConstants.size();
+			uint32_t textConstantsCount = rom_textConstants.size();
+			counts[NUMERIC_CONST] = &numericConstantsCount;
+			counts[TEXT_CONST] = &textConstantsCount;
+			std::vector<bool> used[KIND_COUNT];
+			for (int k = 0; k < KIND_COUNT; ++k) used[k].resize(*counts[k], false);
+			auto use = [&](ByteCode ref) {
+				Kind kind = kindOf(ref.type);
+				if (kind != NO_KIND && ref.value < used[kind].size()) used[kind][ref.value] = true;
+			};
+			
+			// Calls f(addr, size) for each statement, STR and RST have a fixed size and their operands are not references
+			auto forEachStatement = [](const std::vector<ByteCode>& program, auto&& f) {
+				for (uint32_t addr = 0; addr < program.size();) {
+					uint32_t size = 1;
+					if (program[addr].type == OP) {
+						if (program[addr] == STR || program[addr] == RST) size = 4;
+						else while (addr + size < program.size() && program[addr + size - 1].type != VOID) ++size;
+					}
+					f(addr, std::min<uint32_t>(size, program.size() - addr));
+					addr += size;
+				}
+			};
+			auto isRangeStatement = [](const std::vector<ByteCode>& program, uint32_t addr, uint32_t size) {
+				return size == 4 && (program[addr] == STR || program[addr] == RST);
+			};
+			
+			// Everything referenced by the program, including whole ranges of locals saved and restored around recursive calls
+			forEachStatement(rom_program, [&](uint32_t addr, uint32_t size) {
+				if (isRangeStatement(rom_program, addr, size)) {
+					Kind kind = kindOf(rom_program[addr+3].type);
+					if (kind == NO_KIND) return;
+					for (uint32_t i = rom_program[addr+1].rawValue; i < rom_program[addr+1].rawValue + rom_program[addr+2].rawValue && i < used[kind].size(); ++i) used[kind][i] = true;
+				} else {
+					for (uint32_t i = 1; i < size; ++i) use(rom_program[addr + i]);
+				}
+			});
+			for (const auto& [port, input] : inputs) for (uint32_t arg : input.args) use(ByteCode{arg});
+			for (const EntryPoint& entryPoint : entryPoints) {
+				use(entryPoint.ref);
+				for (uint32_t arg : entryPoint.args) use(ByteCode{arg});
+			}
+			// Global variables that are only initialized, the initialization of a kept variable may read another one declared before it
+			std::vector<bool> removed(rom_vars_init.size(), false);
+			std::vector<std::pair<uint32_t, uint32_t>> varsInitStatements;
+			forEachStatement(rom_vars_init, [&](uint32_t addr, uint32_t size){ varsInitStatements.emplace_back(addr, size); });
+			for (auto it = varsInitStatements.rbegin(); it != varsInitStatements.rend(); ++it) {
+				auto [addr, size] = *it;
+				ByteCode dst = size > 1? rom_vars_init[addr+1] : ByteCode{};
+				if (rom_vars_init[addr] == SET && (dst.type == RAM_VAR_NUMERIC || dst.type == RAM_VAR_TEXT) && dst.value < used[kindOf(dst.type)].size() && !used[kindOf(dst.type)][dst.value]) {
+					std::fill(removed.begin() + addr, removed.begin() + addr + size, true);
+				} else {
+					for (uint32_t i = 1; i < size; ++i) use(rom_vars_init[addr + i]);
+				}
+			}
+			
+			// Renumber
+			std::vector<uint32_t> newIndex[KIND_COUNT];
+			for (int k = 0; k < KIND_COUNT; ++k) {
+				newIndex[k].resize(used[k].size() + 1);
+				uint32_t n = 0;
+				for (uint32_t i = 0; i < used[k].size(); ++i) {
+					newIndex[k][i] = n;
+					if (used[k][i]) ++n;
+				}
+				newIndex[k][used[k].size()] = n;
+				*counts[k] = n;
+			}
+			auto remap = [&](ByteCode ref) -> ByteCode {
+				Kind kind = kindOf(ref.type);
+				if (kind != NO_KIND && ref.value < used[kind].size()) ref.value = newIndex[kind][ref.value];
+				return ref;
+			};
+			forEachStatement(rom_program, [&](uint32_t addr, uint32_t size) {
+				if (isRangeStatement(rom_program, addr, size)) {
+					Kind kind = kindOf(rom_program[addr+3].type);
+					if (kind != NO_KIND && rom_program[addr+1].rawValue < used[kind].size()) rom_program[addr+1].rawValue = newIndex[kind][rom_program[addr+1].rawValue];
+				} else {
+					for (uint32_t i = 1; i < size; ++i) rom_program[addr + i] = remap(rom_program[addr + i]);
+				}
+			});
+			std::vector<ByteCode> varsInit;
+			std::vector<uint32_t> newAddr(rom_vars_init.size() + 1);
+			for (uint32_t addr = 0; addr < rom_vars_init.size(); ++addr) {
+				newAddr[addr] = varsInit.size();
+				if (!removed[addr]) varsInit.push_back(remap(rom_vars_init[addr]));
+			}
+			newAddr[rom_vars_init.size()] = varsInit.size();
+			rom_vars_init.swap(varsInit);
+			for (auto* entries : {&debug_vars_init.lines, &debug_vars_init.files}) {
+				std::vector<std::pair<uint32_t, uint32_t>> remapped;
+				for (auto [addr, value] : *entries) {
+					addr = newAddr[std::min<size_t>(addr, newAddr.size() - 1)];
+					if (!remapped.empty() && remapped.back().first == addr) remapped.back().second = value;
+					else remapped.emplace_back(addr, value);
+				}
+				entries->swap(remapped);
+			}
+			for (auto& [port, input] : inputs) for (uint32_t& arg : input.args) arg = remap(ByteCode{arg}).rawValue;
+			for (EntryPoint& entryPoint : entryPoints) {
+				entryPoint.ref = remap(entryPoint.ref);
+				for (uint32_t& arg : entryPoint.args) arg = remap(ByteCode{arg}).rawValue;
+			}
+			auto compact = [&](auto& constants, Kind kind) {
+				uint32_t n = 0;
+				for (uint32_t i = 0; i < constants.size(); ++i) {
+					if (!used[kind][i]) continue;
+					if (n != i) constants[n] = std::move(constants[i]);
+					++n;
+				}
+				constants.resize(n);
+			};
+			compact(rom_numericConstants, NUMERIC_CONST);
+			compact(rom_textConstants, TEXT_CONST);
+			userVars.Remap(remap);
+		}
+		
 	public:
+		const DeviceContext* context; // declarations this program is compiled or loaded against
 		uint32_t varsInitSize = 0; // number of byte codes in the vars_init code (uint32_t)
 		uint32_t programSize = 0; // number of byte codes in the program code (uint32_t)
 		std::vector<std::string> storageRefs {}; // storage references (addr)
@@ -2855,6 +4997,18 @@ const int VERSION_PATCH = 0;
 		std::vector<double> rom_numericConstants {}; // the actual numeric constant values
 		std::vector<std::string> rom_textConstants {}; // the actual text constant values
 		
+		// Debug
+		DebugInfo debug_vars_init {};
+		DebugInfo debug_program {};
+		
+		// Pre-decoded dispatch streams, built when loading the program (one DecodedCode per bytecode word, parallel to the rom_* bytecode above)
+		std::vector<DecodedCode> dispatch_vars_init {};
+		std::vector<DecodedCode> dispatch_program {};
+		std::vector<DecodedCode> dispatch_program_checked {}; // dispatch_program without the unchecked array accesses, empty if there are none (see FindIndexedLoops)
+		std::vector<DeviceCallSite> deviceCallSites {}; // referenced by DecodedCode::link of each DEV
+		std::vector<DeviceCallSite::ArgKind> deviceCallArgKinds {}; // argument kinds of all device call sites, one after the other
+		std::vector<IndexedLoop> indexedLoops {}; // loops of rom_program with unchecked array accesses
+		
 		// RAM size
 		uint32_t ram_numericVariables = 0;
 		uint32_t ram_textVariables = 0;
@@ -2874,7 +5028,7 @@ const int VERSION_PATCH = 0;
 		}
 		
 		// From Parsed lines of code
-		explicit Assembly(const std::vector<ParsedLine>& lines, bool verbose) {
+		explicit Assembly(const std::vector<ParsedLine>& lines, bool verbose, const DeviceContext& context_ = GetDefaultDeviceContext(), int optimizationLevel = XC_OPTIMIZATION_LEVEL) : context(&context_) {
 			// Current context
 			std::string currentFile = "";
 			uint32_t currentLine = 0;
@@ -2895,8 +5049,10 @@ const int VERSION_PATCH = 0;
 			uint32_t ram_numericArrays_offset = 0;
 			uint32_t ram_textArrays_offset = 0;
 			
-			// Temporary user-defined symbol maps
-			std::unordered_map<std::string/*functionName*/, std::map<int/*stackId*/, std::unordered_map<std::string/*name*/, ByteCode>>> userVars {};
+			// Temporary user-defined symbols
+			SymbolTable userVars {};
+			const uint32_t globalFunctionId = userVars.Intern("");
+			uint32_t currentFunctionId = globalFunctionId; // interned currentFunctionName
 			
 			// Validation helper
 			auto validate = [](bool condition){
@@ -2906,43 +5062,81 @@ const int VERSION_PATCH = 0;
 			};
 			
 			// Add a rom constant (numeric or text) and return the index, with duplicate detection.
-			auto addRomConstant = []<typename TConstants, typename TValue>(TConstants & romConstants, const TValue & value) -> size_t {
-				auto it = std::find(romConstants.cbegin(), romConstants.cend(), static_cast<TValue>(value));
-				if (it != romConstants.cend()) {
-					return std::distance(romConstants.cbegin(), it);
-				} else {
-					const auto index = romConstants.size();
-					romConstants.emplace_back(value);
-					return index;
+			// Constants are indexed by value while compiling, the pools themselves keep the order in which constants were first added.
+			std::unordered_map<double, uint32_t> romNumericConstantsIndex {};
+			std::unordered_map<std::string, uint32_t> romTextConstantsIndex {};
+			auto addRomConstant = [&]<typename TConstants, typename TValue>(TConstants & romConstants, const TValue & value) -> size_t {
+				using T = typename TConstants::value_type;
+				const T& constant = static_cast<const T&>(value);
+				auto& constantsIndex = [&]() -> auto& {
+					if constexpr (std::is_same_v<T, double>) return romNumericConstantsIndex;
+					else return romTextConstantsIndex;
+				}();
+				if constexpr (std::is_same_v<T, double>) {
+					if (constant != constant) { // NaN never equals a previous constant
+						romConstants.emplace_back(constant);
+						return romConstants.size() - 1;
+					}
 				}
+				auto [it, inserted] = constantsIndex.try_emplace(constant, uint32_t(romConstants.size())); // note: 0.0 and -0.0 compare (and hash) equal, like with a linear search
+				if (inserted) {
+					romConstants.emplace_back(constant);
+				}
+				return it->second;
 			};
 
 			// Lambda functions to Get/Add user-defined symbols
+			auto findVar = [&](const std::string& name) -> const ByteCode* {
+				uint32_t symbol = userVars.Find(name);
+				if (auto var = userVars.Get(currentFunctionId, symbol)) return var;
+				return userVars.Get(globalFunctionId, 0, symbol);
+			};
 			auto getVar = [&](const std::string& name) -> ByteCode {
-				for (int s = stack.size()-1; s >= -1; --s) {
-					if (userVars[currentFunctionName][s<0?0:stack[s].id].contains(name)) {
-						return userVars.at(currentFunctionName).at(s<0?0:stack[s].id).at(name);
-					}
+				if (auto var = findVar(name)) return *var;
+				throw CompileError("$" + name + " is undefined");
+			};
+			// Temporaries within functions: those of a statement are dead once the statement is compiled and their slots are reused by the next statements of the same function,
+			// except for statements opening a block (loops re-evaluate their condition using them) whose temporaries are kept until the end of that block.
+			std::vector<ByteCode> freeTmpNumeric {};
+			std::vector<ByteCode> freeTmpText {};
+			std::vector<ByteCode> statementTmps {}; // allocated by the statement being compiled
+			std::vector<std::vector<ByteCode>> stackTmps {}; // allocated by the statement that opened each stack level
+			bool statementPushedStack = false;
+			bool freshTmps = false; // the return value of a recursive call must be outside of the restored range of local variables
+			std::vector<ByteCode> functionTmps {}; // all the slots ever allocated for temporaries within functions (see Optimizer)
+			std::vector<Optimizer::Function> compiledFunctions {};
+			auto releaseTmps = [&](std::vector<ByteCode>& tmps) {
+				for (ByteCode tmp : tmps) {
+					(tmp.type == RAM_VAR_NUMERIC? freeTmpNumeric : freeTmpText).push_back(tmp);
 				}
-				if (currentFunctionName != "") {
-					if (userVars[""][0].contains(name)) {
-						return userVars.at("").at(0).at(name);
-					}
+				tmps.clear();
+			};
+			auto endStatement = [&] {
+				if (statementPushedStack && !stackTmps.empty()) {
+					stackTmps.back().insert(stackTmps.back().end(), statementTmps.begin(), statementTmps.end());
+					statementTmps.clear();
+				} else {
+					releaseTmps(statementTmps);
 				}
-				throw CompileError("$" + name + " is undefined");
+				statementPushedStack = false;
 			};
+			
 			auto declareVar = [&](const std::string& name, CODE_TYPE type, Word initialValue/*Only for Const*/ = Word::Empty) -> ByteCode {
-				if (name != "") {
-					for (int s = stack.size()-1; s >= -1; --s) {
-						if (userVars[currentFunctionName][s<0?0:stack[s].id].contains(name)) {
-							throw CompileError("$" + name + " is already defined");
-						}
-					}
-					if (currentFunctionName != "") {
-						if (userVars[""][0].contains(name)) {
-							throw CompileError("$" + name + " is already defined");
-						}
+				if (name == "" && currentFunctionName != "" && (type == RAM_VAR_NUMERIC || type == RAM_VAR_TEXT)) {
+					auto& freeTmps = type == RAM_VAR_NUMERIC? freeTmpNumeric : freeTmpText;
+					ByteCode tmp;
+					if (!freeTmps.empty() && !freshTmps) {
+						tmp = freeTmps.back();
+						freeTmps.pop_back();
+					} else {
+						tmp = {uint8_t(type), type == RAM_VAR_NUMERIC? ram_numericVariables++ : ram_textVariables++};
+						functionTmps.push_back(tmp);
 					}
+					statementTmps.push_back(tmp);
+					return tmp;
+				}
+				if (name != "" && findVar(name)) {
+					throw CompileError("$" + name + " is already defined");
 				}
 				
 				uint32_t index;
@@ -3021,30 +5215,21 @@ const int VERSION_PATCH = 0;
 				
 				ByteCode byteCode{uint8_t(type), index};
 				if (name != "") {
-					userVars[currentFunctionName][currentStackId].emplace(name, byteCode);
+					userVars.Bind(currentFunctionId, currentStackId, userVars.Intern(name), byteCode);
 				}
 				return byteCode;
 			};
 			auto declareTmpNumeric = [&] {return declareVar("", RAM_VAR_NUMERIC);};
 			auto declareTmpText = [&] {return declareVar("", RAM_VAR_TEXT);};
 			auto getReturnVar = [&](const std::string& funcName) -> ByteCode {
-				std::string retVarName = "@"+funcName+":";
-				if (userVars.contains(funcName) && userVars.at(funcName).contains(0) && userVars.at(funcName).at(0).contains(retVarName)) {
-					return userVars.at(funcName).at(0).at(retVarName);
+				if (auto ret = userVars.Get(userVars.Find(funcName), 0, userVars.Find("@"+funcName+":"))) {
+					return *ret;
 				} else {
 					throw CompileError("Function", funcName, "does not have a return type");
 				}
 			};
 			auto getVarName = [&](ByteCode code) -> std::string {
-				for (const auto& [fun,stacks] : userVars) {
-					for (const auto& [s,vars] : stacks) {
-						for (const auto& [name,byteCode] : vars) {
-							if (byteCode.type == code.type && byteCode.value == code.value) {
-								return name;
-							}
-						}
-					}
-				}
+				if (auto name = userVars.GetName(code)) return *name;
 				return std::to_string(code.value);
 			};
 			auto getFunctionName = [&](ByteCode code) -> std::string {
@@ -3094,20 +5279,23 @@ const int VERSION_PATCH = 0;
 					throw CompileError("Function " + name + " is already defined");
 				}
 				currentFunctionName = name;
+				currentFunctionId = userVars.Intern(name);
+				freeTmpNumeric.clear();
+				freeTmpText.clear();
 				currentFunctionAddr = addr();
 				if (currentFunctionName == "system.timer") {
 					assert(currentTimerInterval);
 					timers.emplace_back(currentTimerInterval, currentFunctionAddr);
 					currentTimerInterval = 0;
-					userVars["system.timer"].clear();
+					userVars.Clear(currentFunctionId);
 				} else if (currentFunctionName == "system.input") {
 					inputs[currentInputPort].addr = currentFunctionAddr;
 					currentInputPort = 0;
-					userVars["system.input"].clear();
+					userVars.Clear(currentFunctionId);
 				} else if (currentFunctionName.starts_with("entrypoint.")) {
 					assert(entryPoints.size() > 0);
 					entryPoints.back().addr = currentFunctionAddr;
-					userVars[currentFunctionName].clear();
+					userVars.Clear(currentFunctionId);
 				} else if (currentFunctionName != "") {
 					functionRefs.emplace(currentFunctionName, currentFunctionAddr);
 				}
@@ -3115,7 +5303,23 @@ const int VERSION_PATCH = 0;
 			auto closeCurrentFunction = [&](){
 				if (currentFunctionName != "") {
 					write(RETURN);
+					Optimizer::Function function {currentFunctionAddr, uint32_t(addr()), currentFunctionRecursive, VOID};
+					for (int i = 1; auto param = userVars.Get(currentFunctionId, 0, userVars.Find("@"+currentFunctionName+"."+std::to_string(i))); ++i) {
+						function.params.push_back(*param);
+					}
+					if (auto ret = userVars.Get(currentFunctionId, 0, userVars.Find("@"+currentFunctionName+":"))) {
+						function.returnVar = *ret;
+					}
+					function.numericVariables[0] = ram_numericVariables_offset;
+					function.numericVariables[1] = ram_numericVariables;
+					function.textVariables[0] = ram_textVariables_offset;
+					function.textVariables[1] = ram_textVariables;
+					compiledFunctions.push_back(std::move(function));
 					currentFunctionName = "";
+					currentFunctionId = globalFunctionId;
+					freeTmpNumeric.clear();
+					freeTmpText.clear();
+					statementTmps.clear();
 				}
 				currentFunctionAddr = 0;
 				currentFunctionRecursive = false;
@@ -3138,8 +5342,8 @@ const int VERSION_PATCH = 0;
 					int i = 0;
 					for (auto arg : args) {
 						std::string argVarName = "@"+funcName+"."+std::to_string(++i);
-						if (userVars.contains(funcName) && userVars.at(funcName).contains(0) && userVars.at(funcName).at(0).contains(argVarName)) {
-							ByteCode param = userVars.at(funcName).at(0).at(argVarName);
+						if (auto paramRef = userVars.Get(userVars.Find(funcName), 0, userVars.Find(argVarName))) {
+							ByteCode param = *paramRef;
 							if (IsArray(arg)) { // Don't allow arrays to be passed as arguments
 								throw CompileError("Cannot pass an array to function", func, "in arg " + std::to_string(i));
 							}
@@ -3183,12 +5387,12 @@ const int VERSION_PATCH = 0;
 
 					// If non-prefixed identifier without arguments, check if actually a global constant and convert to a ROM Constant ByteCode.
 					if (args.empty()) {
-						if (Implementation::globalNumericConstants.contains(funcName)) {
-							const auto constantValue = Implementation::globalNumericConstants.at(funcName);
+						if (context->globalNumericConstants.contains(funcName)) {
+							const auto constantValue = context->globalNumericConstants.at(funcName);
 							const auto index = addRomConstant(rom_numericConstants, constantValue);
 							return { ROM_CONST_NUMERIC, static_cast<uint32_t>(index) };
-						} else if (Implementation::globalTextConstants.contains(funcName)) {
-							const auto constantValue = Implementation::globalTextConstants.at(funcName);
+						} else if (context->globalTextConstants.contains(funcName)) {
+							const auto constantValue = context->globalTextConstants.at(funcName);
 							const auto index = addRomConstant(rom_textConstants, constantValue);
 							return { ROM_CONST_TEXT, static_cast<uint32_t>(index) };
 						}
@@ -3208,8 +5412,8 @@ const int VERSION_PATCH = 0;
 					ByteCode ret = VOID;
 					ByteCode f = VOID;
 					if (isTrailingFunction && args.size() > 0 && args[0].type >= RAM_OBJECT) {
-						std::string objType = Device::objectNamesById[args[0].type & (RAM_OBJECT-1)];
-						if (Device::deviceFunctionsByName.contains(objType+"::"+funcName)) {
+						std::string objType = context->GetObjectTypeName(args[0].type & (RAM_OBJECT-1));
+						if (context->deviceFunctionsByName.contains(objType+"::"+funcName)) {
 							funcName = objType+"::"+funcName;
 							f = DEV;
 						}
@@ -3219,10 +5423,10 @@ const int VERSION_PATCH = 0;
 					}
 					write(f);
 					if (f == DEV) {
-						if (!Device::deviceFunctionsByName.contains(funcName)) {
+						if (!context->deviceFunctionsByName.contains(funcName)) {
 							throw CompileError("Function", func, "does not exist");
 						}
-						auto& function = Device::deviceFunctionsByName.at(funcName);
+						auto& function = context->deviceFunctionsByName.at(funcName);
 						write({DEVICE_FUNCTION_INDEX, function.id});
 						if (getReturn) {
 							if (function.returnType == "number") {
@@ -3232,8 +5436,8 @@ const int VERSION_PATCH = 0;
 							} else if (function.returnType == "") {
 								throw CompileError("A function call here should return a value, but", funcName, "does not");
 							} else {
-								validate(Device::objectTypesByName.contains(function.returnType));
-								retType = CODE_TYPE(RAM_OBJECT | Device::objectTypesByName.at(function.returnType).id);
+								validate(context->objectTypesByName.contains(function.returnType));
+								retType = CODE_TYPE(RAM_OBJECT | context->objectTypesByName.at(function.returnType).id);
 							}
 						} else if (function.returnType != "") {
 							write(DISCARD); // We may discard the return value of a device function
@@ -3353,7 +5557,9 @@ const int VERSION_PATCH = 0;
 				};
 
 				writeRecurse(STR);
+				freshTmps = true;
 				auto ref = compileFunctionCall(Word(Word::Type::Funcname, currentFunctionName), args, getReturn, false, true);
+				freshTmps = false;
 				writeRecurse(RST);
 				return ref;
 			};
@@ -3381,6 +5587,8 @@ const int VERSION_PATCH = 0;
 			auto pushStack = [&](const std::string& type) {
 				++currentScope;
 				stack.emplace_back(++currentStackId, type);
+				stackTmps.emplace_back();
+				statementPushedStack = true;
 				assert(currentScope == (int)stack.size());
 			};
 			auto popStack = [&] {
@@ -3392,7 +5600,9 @@ const int VERSION_PATCH = 0;
 				applyPointersAddresses();
 				--currentScope;
 				stack.pop_back();
-				userVars[currentFunctionName][currentStackId].clear();
+				releaseTmps(stackTmps.back());
+				stackTmps.pop_back();
+				userVars.Clear(currentFunctionId, currentStackId);
 				currentStackId = stack.size() > 0 ? stack.back().id : 0;
 				assert(currentScope == (int)stack.size());
 			};
@@ -3403,11 +5613,11 @@ const int VERSION_PATCH = 0;
 					return GetConstValue(getVar(word));
 				}
 				if (word == Word::Name) {
-					if (Implementation::globalNumericConstants.contains(word.word)) {
-						return Word{Implementation::globalNumericConstants.at(word.word)};
+					if (context->globalNumericConstants.contains(word.word)) {
+						return Word{context->globalNumericConstants.at(word.word)};
 					}
-					if (Implementation::globalTextConstants.contains(word.word)) {
-						return Word{Implementation::globalTextConstants.at(word.word)};
+					if (context->globalTextConstants.contains(word.word)) {
+						return Word{context->globalTextConstants.at(word.word)};
 					}
 					throw CompileError("Const", word.word, "is undefined or not a constant");
 				}
@@ -3884,6 +6094,7 @@ const int VERSION_PATCH = 0;
 			// Start parsing
 			try {
 				for (const auto& line : lines) if (line) {
+					endStatement();
 					currentLine = line.line;
 					int nextWordIndex = 0;
 					auto readWord = [&] (Word::Type type = Word::Empty) -> Word {
@@ -3896,12 +6107,12 @@ const int VERSION_PATCH = 0;
 					auto firstWord = readWord();
 					if (line.scope == 0) {
 						// Global Scope
-						if (currentLine) rom_vars_init.emplace_back(ByteCode{LINENUMBER, currentLine});
+						if (currentLine) debug_vars_init.AddLine(rom_vars_init.size(), currentLine);
 						switch (firstWord.type) {
 							case Word::FileInfo:{
 								currentFile = firstWord.word;
-								write({SOURCEFILE, uint32_t(sourceFiles.size())});
-								rom_vars_init.emplace_back(ByteCode{SOURCEFILE, uint32_t(sourceFiles.size())});
+								debug_program.AddFile(rom_program.size(), sourceFiles.size());
+								debug_vars_init.AddFile(rom_vars_init.size(), sourceFiles.size());
 								sourceFiles.emplace_back(currentFile);
 							}break;
 							case Word::Name: {
@@ -4046,8 +6257,8 @@ const int VERSION_PATCH = 0;
 											
 											std::function<ByteCode(const std::string&)> compileConstFunctionCall = [&](const std::string& funcName) -> ByteCode {
 											
-												if (Implementation::globalNumericConstants.contains(funcName)) {
-													const auto constantValue = Implementation::globalNumericConstants.at(funcName);
+												if (context->globalNumericConstants.contains(funcName)) {
+													const auto constantValue = context->globalNumericConstants.at(funcName);
 													const auto index = addRomConstant(rom_numericConstants, constantValue);
 													ByteCode constantRef{ ROM_CONST_NUMERIC, static_cast<uint32_t>(index) };
 													if (name != "") {
@@ -4062,8 +6273,8 @@ const int VERSION_PATCH = 0;
 														return var;
 													}
 													return constantRef;
-												} else if (Implementation::globalTextConstants.contains(funcName)) {
-													const auto constantValue = Implementation::globalTextConstants.at(funcName);
+												} else if (context->globalTextConstants.contains(funcName)) {
+													const auto constantValue = context->globalTextConstants.at(funcName);
 													const auto index = addRomConstant(rom_textConstants, constantValue);
 													ByteCode constantRef{ ROM_CONST_TEXT, static_cast<uint32_t>(index) };
 													if (name != "") {
@@ -4080,10 +6291,10 @@ const int VERSION_PATCH = 0;
 													return constantRef;
 												}
 												
-												if (!Device::deviceFunctionsByName.contains(funcName)) {
+												if (!context->deviceFunctionsByName.contains(funcName)) {
 													throw CompileError("Function", funcName, "does not exist");
 												}
-												auto& function = Device::deviceFunctionsByName.at(funcName);
+												auto& function = context->deviceFunctionsByName.at(funcName);
 												CODE_TYPE retType;
 												if (function.returnType == "number") {
 													retType = RAM_VAR_NUMERIC;
@@ -4092,8 +6303,8 @@ const int VERSION_PATCH = 0;
 												} else if (function.returnType == "") {
 													throw CompileError("A function call here should return a value, but", funcName, "does not");
 												} else {
-													validate(Device::objectTypesByName.contains(function.returnType));
-													retType = CODE_TYPE(RAM_OBJECT | Device::objectTypesByName.at(function.returnType).id);
+													validate(context->objectTypesByName.contains(function.returnType));
+													retType = CODE_TYPE(RAM_OBJECT | context->objectTypesByName.at(function.returnType).id);
 												}
 												
 												ByteCode var = declareVar(name, retType);
@@ -4239,13 +6450,13 @@ const int VERSION_PATCH = 0;
 										} else if (type == "text") {
 											arg = declareVar(word, RAM_VAR_TEXT);
 										} else {
-											if (Device::objectTypesByName.contains(type)) {
-												arg = declareVar(word, CODE_TYPE(RAM_OBJECT | Device::objectTypesByName.at(type).id));
+											if (context->objectTypesByName.contains(type)) {
+												arg = declareVar(word, CODE_TYPE(RAM_OBJECT | context->objectTypesByName.at(type).id));
 											} else {
 												throw CompileError("Invalid argument type in function declaration");
 											}
 										}
-										userVars[currentFunctionName][0].emplace("@"+name+"."+std::to_string(argN), arg);
+										userVars.Bind(currentFunctionId, 0, userVars.Intern("@"+name+"."+std::to_string(argN)), arg);
 									}
 									// Return type
 									if (readWord() == Word::CastOperator) {
@@ -4255,8 +6466,8 @@ const int VERSION_PATCH = 0;
 										} else if (type == "text") {
 											declareVar("@"+name+":", RAM_VAR_TEXT);
 										} else {
-											if (Device::objectTypesByName.contains(type)) {
-												declareVar("@"+name+":", CODE_TYPE(RAM_OBJECT | Device::objectTypesByName.at(type).id));
+											if (context->objectTypesByName.contains(type)) {
+												declareVar("@"+name+":", CODE_TYPE(RAM_OBJECT | context->objectTypesByName.at(type).id));
 											} else {
 												throw CompileError("Invalid return type in function declaration");
 											}
@@ -4309,8 +6520,8 @@ const int VERSION_PATCH = 0;
 										} else if (type == "text") {
 											arg = declareVar(word, RAM_VAR_TEXT);
 										} else {
-											if (Device::objectTypesByName.contains(type)) {
-												arg = declareVar(word, CODE_TYPE(RAM_OBJECT | Device::objectTypesByName.at(type).id));
+											if (context->objectTypesByName.contains(type)) {
+												arg = declareVar(word, CODE_TYPE(RAM_OBJECT | context->objectTypesByName.at(type).id));
 											} else {
 												throw CompileError("Invalid argument type in function declaration");
 											}
@@ -4325,7 +6536,7 @@ const int VERSION_PATCH = 0;
 									pushStack("function");
 								}
 								// entry points
-								else if (find(begin(Implementation::entryPoints), end(Implementation::entryPoints), firstWord.word) != end(Implementation::entryPoints)) {
+								else if (IsDeclaredEntryPoint(*context, firstWord.word)) {
 									size_t entryPointIndex = entryPoints.size();
 									auto& entryPoint = entryPoints.emplace_back();
 									entryPoint.name = firstWord.word;
@@ -4360,8 +6571,8 @@ const int VERSION_PATCH = 0;
 											} else if (type == "text") {
 												arg = declareVar(word, RAM_VAR_TEXT);
 											} else {
-												if (Device::objectTypesByName.contains(type)) {
-													arg = declareVar(word, CODE_TYPE(RAM_OBJECT | Device::objectTypesByName.at(type).id));
+												if (context->objectTypesByName.contains(type)) {
+													arg = declareVar(word, CODE_TYPE(RAM_OBJECT | context->objectTypesByName.at(type).id));
 												} else {
 													throw CompileError("Invalid argument type in function declaration");
 												}
@@ -4387,7 +6598,7 @@ const int VERSION_PATCH = 0;
 					} else {
 						// Function Scope
 						if (currentLine) {
-							write({LINENUMBER, currentLine});
+							debug_program.AddLine(rom_program.size(), currentLine);
 						}
 						if (line.scope > currentScope) {
 							throw CompileError("Invalid scope");
@@ -4396,7 +6607,7 @@ const int VERSION_PATCH = 0;
 							if (line.scope == currentScope - 1) {
 								if (firstWord == "elseif" || firstWord == "else") {
 									validate(stack.back().type == "if");
-									userVars[currentFunctionName][currentStackId].clear(); // popStack+pushStack would cause our pointers to be lost
+									userVars.Clear(currentFunctionId, currentStackId); // popStack+pushStack would cause our pointers to be lost
 									break;
 								}
 							}
@@ -5222,7 +7433,7 @@ const int VERSION_PATCH = 0;
 								else if (firstWord == "elseif") {
 									addPointer("") = gotoAddr(0); // endIf
 									applyPointerAddr("gotoIfFalse");
-									write({LINENUMBER, currentLine});
+									debug_program.AddLine(rom_program.size(), currentLine);
 									ByteCode ref = compileExpression(line.words, nextWordIndex, -1);
 									write(CND);
 									addPointer("gotoIfTrue") = write(ADDR);
@@ -5249,7 +7460,7 @@ const int VERSION_PATCH = 0;
 									}
 									write(RETURN);
 								}
-								else if (Device::deviceFunctionsByName.contains(firstWord.word) || firstWord == "recurse") {
+								else if (context->deviceFunctionsByName.contains(firstWord.word) || firstWord == "recurse") {
 									// Device Function call
 									std::vector<ByteCode> args {};
 									validate(readWord() == Word::ExpressionBegin);
@@ -5279,6 +7490,7 @@ const int VERSION_PATCH = 0;
 						}
 					}
 				}
+				endStatement();
 				while (currentScope > 0) {
 					popStack();
 				}
@@ -5288,6 +7500,33 @@ const int VERSION_PATCH = 0;
 				err << e.what() << " in " << currentFile << ":" << currentLine;
 				throw CompileError(err.str());
 			}
+			
+			// Optimize
+			if (optimizationLevel > 0) {
+				Optimizer optimizer(rom_program, rom_numericConstants, rom_textConstants, debug_program, ram_numericVariables, ram_textVariables);
+				// Tree shaking: user functions are only kept when they may be called from the system functions, timers, inputs or entry points
+				for (auto& [name, address] : functionRefs) if (name.starts_with("system.")) optimizer.AddRoot(address);
+				for (auto& timer : timers) optimizer.AddRoot(timer.addr);
+				for (auto& [port, input] : inputs) optimizer.AddRoot(input.addr);
+				for (auto& entryPoint : entryPoints) optimizer.AddRoot(entryPoint.addr);
+				for (ByteCode tmp : functionTmps) optimizer.AddTemporary(tmp);
+				for (const auto& function : compiledFunctions) optimizer.AddFunction(function);
+				optimizer.Run(optimizationLevel);
+				for (auto ref = functionRefs.begin(); ref != functionRefs.end();) {
+					auto it = std::lower_bound(compiledFunctions.begin(), compiledFunctions.end(), ref->second, [](const Optimizer::Function& f, uint32_t a){ return f.addr < a; });
+					if (!ref->first.starts_with("system.") && it != compiledFunctions.end() && it->addr == ref->second) {
+						const Optimizer::Function& function = optimizer.GetFunctions()[it - compiledFunctions.begin()];
+						if (function.addr == function.end) { // all of its code was removed
+							ref = functionRefs.erase(ref);
+							continue;
+						}
+						ref->second = function.addr;
+					}
+					++ref;
+				}
+				RemoveUnusedVariablesAndConstants(userVars);
+			}
+			
 			varsInitSize = rom_vars_init.size();
 			programSize = rom_program.size();
 			
@@ -5295,11 +7534,19 @@ const int VERSION_PATCH = 0;
 			if (verbose) {
 				bool nextLine = true;
 				uint32_t address = 0;
+				auto debugFile = debug_program.files.begin();
+				auto debugLine = debug_program.lines.begin();
 				for (const ByteCode& code : rom_program) {
 					if (nextLine) {
 						std::cout << "\n" << getFunctionName({ADDR,address}) << std::endl;
 						nextLine = false;
 					}
+					for (; debugFile != debug_program.files.end() && debugFile->first == address; ++debugFile) {
+						std::cout << "FILE: " << sourceFiles[debugFile->second] << "\n";
+					}
+					for (; debugLine != debug_program.lines.end() && debugLine->first == address; ++debugLine) {
+						std::cout << "LINE: " << debugLine->second << "\n";
+					}
 					++address;
 					switch (code.type) {
 						case RETURN:
@@ -5320,12 +7567,6 @@ const int VERSION_PATCH = 0;
 							std::cout << op;
 							std::cout << "  ";
 							}break;
-						case SOURCEFILE:{
-							std::cout << "FILE: " << sourceFiles[code.value] << "\n";
-						}break;
-						case LINENUMBER:{
-							std::cout << "LINE: " << code.value << "\n";
-						}break;
 						case ROM_CONST_NUMERIC:
 							std::cout << "ROM_CONST_NUMERIC{";
 							std::cout << "$" << getVarName(code);
@@ -5394,8 +7635,8 @@ const int VERSION_PATCH = 0;
 							std::cout << "ADDR{" << getFunctionName(code) << "} ";
 							break;
 						default:
-							if (code.type >= RAM_OBJECT && Device::objectNamesById.contains(code.type & (RAM_OBJECT-1))) {
-								std::cout << "RAM_OBJECT:" << Device::objectNamesById.at(code.type & (RAM_OBJECT-1)) << "{";
+							if (code.type >= RAM_OBJECT && context->objectNamesById.contains(code.type & (RAM_OBJECT-1))) {
+								std::cout << "RAM_OBJECT:" << context->objectNamesById.at(code.type & (RAM_OBJECT-1)) << "{";
 								std::cout << "$" << getVarName(code);
 								std::cout << "} ";
 							} else {
@@ -5405,23 +7646,284 @@ const int VERSION_PATCH = 0;
 				}
 				std::cout << std::endl;
 			}
+			
+			Predecode();
 		}
 
 		// From ByteCode stream
-		explicit Assembly(std::istream& s) {
+		explicit Assembly(std::istream& s, const DeviceContext& context_ = GetDefaultDeviceContext()) : context(&context_) {
 			assert(std::string(XC_APP_NAME) != "");
 			assert(XC_APP_VERSION != 0);
 			Read(s);
+			Predecode();
+		}
+		
+		// Resolve the dense opcode index of every bytecode word and link device function calls, so that the interpreter does not have to decode them at runtime
+		void Predecode() {
+			deviceCallSites.clear();
+			deviceCallArgKinds.clear();
+			auto linkDeviceCall = [this](const std::vector<ByteCode>& program, uint32_t addr) -> uint32_t {
+				const size_t size = program.size();
+				auto codeAt = [&](size_t i) -> ByteCode { return i < size? program[i] : ByteCode{CODE_TYPE::VOID}; };
+				DeviceCallSite& call = deviceCallSites.emplace_back();
+				call.argKinds = deviceCallArgKinds.size();
+				ByteCode dev = codeAt(addr+1);
+				uint8_t funcBase = (dev.value >> 16) & 0xFF;
+				uint32_t funcIndex = (dev.value & 0xFFFF); // 1-based
+				if (dev.type != DEVICE_FUNCTION_INDEX || funcBase >= 128 || funcIndex == 0 || funcIndex > context->deviceFunctionVectors[funcBase].size() || !context->deviceFunctionVectors[funcBase][funcIndex - 1]) {
+					call.argsAddr = call.endAddr = std::min<size_t>(addr+1, size-1);
+					return deviceCallSites.size() - 1;
+				}
+				call.function = context->deviceFunctionVectors[funcBase][funcIndex - 1];
+				bool hasReturn = context->deviceFunctionHasReturnVectors[funcBase][funcIndex - 1];
+				call.dst = hasReturn? codeAt(addr+2) : ByteCode{0};
+				call.argsAddr = addr + (hasReturn? 3 : 2);
+				call.endAddr = call.argsAddr;
+				while (call.endAddr < size && program[call.endAddr].type != VOID) {
+					ByteCode arg = program[call.endAddr++];
+					deviceCallArgKinds.push_back(IsNumeric(arg)? DeviceCallSite::ARG_NUMERIC : IsText(arg)? DeviceCallSite::ARG_TEXT : IsObject(arg)? DeviceCallSite::ARG_OBJECT : DeviceCallSite::ARG_INVALID);
+				}
+				if (call.endAddr >= size) call.endAddr = size - 1; // missing VOID terminator, stop at the end of the program
+				const DeviceCallSite::ArgKind* kinds = deviceCallArgKinds.data() + call.argKinds;
+				const size_t argc = deviceCallArgKinds.size() - call.argKinds;
+				if (hasReturn && call.dst.type == RAM_VAR_NUMERIC) {
+					if (argc == 0) {
+						call.marshalling = DeviceCallSite::NO_ARGS_TO_NUMERIC;
+					} else if (std::all_of(kinds, kinds + argc, [](auto kind){ return kind == DeviceCallSite::ARG_NUMERIC; })) {
+						call.marshalling = DeviceCallSite::NUMERIC_ARGS_TO_NUMERIC;
+					} else if ((argc >= 2 && kinds[0] == DeviceCallSite::ARG_NUMERIC && kinds[1] == DeviceCallSite::ARG_NUMERIC) || (argc == 1 && kinds[0] == DeviceCallSite::ARG_OBJECT)) {
+						call.marshalling = DeviceCallSite::ARGS_TO_NUMERIC;
+					} else {
+						call.marshalling = DeviceCallSite::GENERIC;
+					}
+				} else {
+					call.marshalling = DeviceCallSite::GENERIC;
+				}
+				const DeviceContext::TypedFunction& typed = context->deviceFunctionTypedVectors[funcBase][funcIndex - 1];
+				if (typed.thunk && argc == typed.args.size()) {
+					bool match = true;
+					for (size_t i = 0; i < argc; ++i) {
+						if (kinds[i] != (typed.args[i] == Var::Numeric? DeviceCallSite::ARG_NUMERIC : DeviceCallSite::ARG_TEXT)) match = false;
+					}
+					if (match) {
+						call.thunk = typed.thunk;
+						call.typedFunction = typed.function;
+						call.functionId = dev.value;
+					}
+				}
+				return deviceCallSites.size() - 1;
+			};
+			auto predecode = [&linkDeviceCall](const std::vector<ByteCode>& program, std::vector<DecodedCode>& dispatch) {
+				const size_t size = program.size();
+				auto isRam = [&](size_t addr){ return addr < size && program[addr].type == RAM_VAR_NUMERIC; };
+				auto isConst = [&](size_t addr){ return addr < size && program[addr].type == ROM_CONST_NUMERIC; };
+				auto isVoid = [&](size_t addr){ return addr < size && program[addr].type == VOID; };
+				// Operand quickening: operand kinds are fixed once loaded, so select a type-specialized variant when possible
+				auto quickenBinary = [&](size_t addr, uint8_t variantRRR) -> uint8_t {
+					if (isRam(addr+1) && (isRam(addr+2) || isConst(addr+2)) && (isRam(addr+3) || isConst(addr+3)) && isVoid(addr+4)) {
+						return variantRRR + (isConst(addr+2)? 2 : 0) + (isConst(addr+3)? 1 : 0);
+					}
+					return GetOpcodeIndex(program[addr].rawValue);
+				};
+				dispatch.clear();
+				dispatch.resize(size, DecodedCode{});
+				for (size_t i = 0; i < size; ++i) {
+					switch (program[i].rawValue) {
+						case SET:
+							if (isRam(i+1) && isVoid(i+3)) {
+								if (isRam(i+2)) { dispatch[i].opcodeIndex = OPCODE_INDEX_SET_RR; continue; }
+								if (isConst(i+2)) { dispatch[i].opcodeIndex = OPCODE_INDEX_SET_RC; continue; }
+							}
+							break;
+						case INC: if (isRam(i+1) && isVoid(i+2)) { dispatch[i].opcodeIndex = OPCODE_INDEX_INC_R; continue; } break;
+						case DEC: if (isRam(i+1) && isVoid(i+2)) { dispatch[i].opcodeIndex = OPCODE_INDEX_DEC_R; continue; } break;
+						case ADD: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_ADD_RRR); continue;
+						case SUB: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_SUB_RRR); continue;
+						case MUL: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_MUL_RRR); continue;
+						case DIV: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_DIV_RRR); continue;
+						case EQQ: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_EQQ_RRR); continue;
+						case NEQ: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_NEQ_RRR); continue;
+						case LST: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_LST_RRR); continue;
+						case GRT: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_GRT_RRR); continue;
+						case LTE: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_LTE_RRR); continue;
+						case GTE: dispatch[i].opcodeIndex = quickenBinary(i, OPCODE_INDEX_GTE_RRR); continue;
+						case DEV: dispatch[i].link = linkDeviceCall(program, i); break;
+					}
+					dispatch[i].opcodeIndex = GetOpcodeIndex(program[i].rawValue);
+				}
+				// Superinstructions: fuse hot pairs of statements, the second one keeps its own entry for jumps that land on it
+				static_assert(OPCODE_INDEX_GTE_RCC_CND - OPCODE_INDEX_EQQ_RRR_CND == OPCODE_INDEX_GTE_RCC - OPCODE_INDEX_EQQ_RRR);
+				for (size_t i = 0; i < size; ++i) {
+					const uint8_t opcodeIndex = dispatch[i].opcodeIndex;
+					if (opcodeIndex >= OPCODE_INDEX_EQQ_RRR && opcodeIndex <= OPCODE_INDEX_GTE_RCC) {
+						if (i+9 < size && program[i+5].rawValue == CND && program[i+6].type == ADDR && program[i+7].type == ADDR && program[i+8].rawValue == program[i+1].rawValue && isVoid(i+9)) {
+							dispatch[i].opcodeIndex = OPCODE_INDEX_EQQ_RRR_CND + (opcodeIndex - OPCODE_INDEX_EQQ_RRR);
+						}
+					} else if (opcodeIndex == OPCODE_INDEX_GTO) {
+						if (i+2 < size && program[i+1].type == ADDR && isVoid(i+2) && program[i+1].value < size && dispatch[program[i+1].value].opcodeIndex == OPCODE_INDEX_INC_R) {
+							dispatch[i].opcodeIndex = OPCODE_INDEX_GTO_INC_R;
+						}
+					} else if (opcodeIndex == OPCODE_INDEX_IDX) {
+						if (isRam(i+1) && i+6 < size && program[i+2].type == RAM_ARRAY_NUMERIC && program[i+3].type == ARRAY_INDEX && program[i+3].value == ARRAY_INDEX_NONE && isRam(i+4) && isVoid(i+5) && dispatch[i+6].opcodeIndex == OPCODE_INDEX_ADD_RRR) {
+							dispatch[i].opcodeIndex = OPCODE_INDEX_IDX_ADD_RRR;
+						}
+					}
+				}
+			};
+			predecode(rom_vars_init, dispatch_vars_init);
+			predecode(rom_program, dispatch_program);
+			FindIndexedLoops();
+		}
+		
+		// Bounds check elimination: in the loops of the program that count from a constant of at least -1 up to the size of a numeric array (foreach and repeat over its size),
+		// the accesses of that array indexed by the loop variable are unchecked if neither of them nor the size of the array may change within the loop.
+		// The embedder may still change memory while the program is suspended in such a loop, Computer::RunCode then resumes with dispatch_program_checked unless the index is still valid.
+		void FindIndexedLoops() {
+			indexedLoops.clear();
+			dispatch_program_checked.clear();
+			const std::vector<ByteCode>& program = rom_program;
+			const uint32_t size = program.size();
+			auto word = [&](uint32_t addr){ return addr < size? program[addr] : ByteCode{CODE_TYPE::VOID}; };
+			
+			// Statements, and the addresses each one may be entered from other than the previous statement (UINT32_MAX when called or returned to)
+			std::vector<uint32_t> statements {};
+			std::vector<std::pair<uint32_t/*target*/, uint32_t/*source*/>> entries {};
+			for (uint32_t i = 0; i < size; ++i) {
+				if (program[i].type == RETURN) statements.push_back(i);
+				if (program[i].type != OP) continue;
+				statements.push_back(i);
+				switch (program[i].rawValue) {
+					case GTO: entries.emplace_back(word(i+1).value, i); break;
+					case CND: entries.emplace_back(word(i+1).value, i); entries.emplace_back(word(i+2).value, i); break;
+					case JMP: entries.emplace_back(word(i+1).value, UINT32_MAX); entries.emplace_back(i+3, UINT32_MAX); break;
+				}
+			}
+			for (const auto& [name, addr] : functionRefs) entries.emplace_back(addr, UINT32_MAX);
+			for (const auto& timer : timers) entries.emplace_back(timer.addr, UINT32_MAX);
+			for (const auto& [port, input] : inputs) entries.emplace_back(input.addr, UINT32_MAX);
+			for (const auto& entryPoint : entryPoints) entries.emplace_back(entryPoint.addr, UINT32_MAX);
+			std::sort(entries.begin(), entries.end());
+			auto entered = [&](uint32_t addr){
+				auto it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(addr, uint32_t(0)));
+				return it != entries.end() && it->first == addr;
+			};
+			
+			// Words written by a statement, and whether it only writes an element of an array
+			auto forEachWritten = [&](uint32_t i, auto&& func) {
+				if (program[i].rawValue == SET && word(i+1).type == ARRAY_INDEX) func(word(word(i+1).value == ARRAY_INDEX_NONE? i+3 : i+2), true);
+				else if (program[i].rawValue == SET && word(i+1).type == OBJ_KEY) func(word(i+3), false);
+				else {
+					func(word(i+1), false);
+					if (program[i].rawValue == KEY) func(word(i+3), false);
+				}
+			};
+			// Statements that may run other code or write anywhere in the RAM
+			auto isOpaque = [&](uint32_t i){
+				switch (program[i].rawValue) {
+					case JMP: case DEV: case OUT: case STR: case RST: return true;
+				}
+				return false;
+			};
+			
+			for (size_t k = 0; k + 3 < statements.size(); ++k) {
+				const uint32_t head = statements[k];
+				const uint32_t body = head + 13;
+				const ByteCode index = word(head+1), cond = word(head+4), count = word(head+6);
+				if (program[head].rawValue != INC || index.type != RAM_VAR_NUMERIC || word(head+2).type != VOID) continue;
+				if (word(head+3).rawValue != LST || cond.type != RAM_VAR_NUMERIC || word(head+5).rawValue != index.rawValue || count.type != RAM_VAR_NUMERIC || word(head+7).type != VOID) continue;
+				if (word(head+8).rawValue != CND || word(head+9).rawValue != ByteCode(ADDR, body).rawValue || word(head+10).type != ADDR || word(head+11).rawValue != cond.rawValue || word(head+12).type != VOID) continue;
+				if (index.rawValue == cond.rawValue || index.rawValue == count.rawValue || cond.rawValue == count.rawValue) continue;
+				const uint32_t end = word(head+10).value;
+				if (end <= body || end > size) continue;
+				
+				// The straight code before the head must set the index to a constant and the count to the size of the array
+				size_t first = k;
+				while (first > 0 && k - first < 16) {
+					const uint32_t i = statements[first-1];
+					if (program[i].type != OP || isOpaque(i) || program[i].rawValue == GTO || program[i].rawValue == CND) break;
+					--first;
+					if (entered(i)) break;
+				}
+				const uint32_t begin = statements[first];
+				std::unordered_map<uint32_t/*var*/, double> constants {};
+				std::unordered_map<uint32_t/*var*/, ByteCode/*array*/> sizes {};
+				for (size_t p = first; p < k; ++p) {
+					const uint32_t i = statements[p];
+					const uint32_t op = program[i].rawValue;
+					const ByteCode dst = word(i+1), src = word(i+2);
+					if (dst.type == RAM_VAR_NUMERIC && (op == SET || op == INC || op == DEC || op == SIZ)) {
+						auto constant = constants.find(op == SET? src.rawValue : dst.rawValue);
+						auto sizeOf = sizes.find(src.rawValue);
+						double value = 0;
+						ByteCode array = 0;
+						if (op == SET && src.type == VOID) value = 0.0;
+						else if (op == SET && src.type == ROM_CONST_NUMERIC && src.value < rom_numericConstants.size()) value = rom_numericConstants[src.value];
+						else if (op == SET && src.type == RAM_VAR_NUMERIC && constant != constants.end()) value = constant->second;
+						else if ((op == INC || op == DEC) && constant != constants.end()) value = std::nearbyint(constant->second) + (op == INC? 1.0 : -1.0);
+						else if (op == SET && src.type == RAM_VAR_NUMERIC && sizeOf != sizes.end()) array = sizeOf->second;
+						else if (op == SIZ && src.type == RAM_ARRAY_NUMERIC) array = src;
+						else value = NAN;
+						constants.erase(dst.rawValue);
+						sizes.erase(dst.rawValue);
+						if (array.type == RAM_ARRAY_NUMERIC) sizes[dst.rawValue] = array;
+						else if (!std::isnan(value)) constants[dst.rawValue] = value;
+					} else {
+						forEachWritten(i, [&](ByteCode ref, bool element){
+							constants.erase(ref.rawValue);
+							sizes.erase(ref.rawValue);
+							if (!element) std::erase_if(sizes, [ref](const auto& entry){ return entry.second.rawValue == ref.rawValue; });
+						});
+					}
+				}
+				if (!constants.contains(index.rawValue) || !sizes.contains(count.rawValue)) continue;
+				const double start = constants[index.rawValue];
+				const ByteCode array = sizes[count.rawValue];
+				if (start < -1 || start != std::nearbyint(start)) continue;
+				
+				// The loop may only be entered through the straight code before it, the body only from the head
+				bool valid = true;
+				for (auto it = std::upper_bound(entries.begin(), entries.end(), std::make_pair(begin, UINT32_MAX)); it != entries.end() && it->first < end; ++it) {
+					if ((it->first != head && it->first < body) || it->second < head || it->second >= end) valid = false;
+				}
+				// Neither the index, the count nor the size of the array may change within the loop
+				for (size_t p = k + 3; valid && p < statements.size() && statements[p] < end; ++p) {
+					const uint32_t i = statements[p];
+					if (program[i].type != OP) continue;
+					if (isOpaque(i)) valid = false;
+					else forEachWritten(i, [&](ByteCode ref, bool element){
+						if (ref.rawValue == index.rawValue || ref.rawValue == count.rawValue || (ref.rawValue == array.rawValue && !element)) valid = false;
+					});
+				}
+				if (!valid) continue;
+				
+				// Accesses of the array indexed by the loop variable
+				bool unchecked = false;
+				for (size_t p = k + 3; p < statements.size() && statements[p] < end; ++p) {
+					const uint32_t i = statements[p];
+					DecodedCode& decoded = dispatch_program[i];
+					if (program[i].rawValue == IDX && word(i+1).type == RAM_VAR_NUMERIC && word(i+2).rawValue == array.rawValue && word(i+3).rawValue == ByteCode(ARRAY_INDEX, ARRAY_INDEX_NONE).rawValue && word(i+4).rawValue == index.rawValue && word(i+5).type == VOID) {
+						if (dispatch_program_checked.empty()) dispatch_program_checked = dispatch_program;
+						if (decoded.opcodeIndex == OPCODE_INDEX_IDX) decoded.opcodeIndex = OPCODE_INDEX_IDX_UNCHECKED;
+						else if (decoded.opcodeIndex == OPCODE_INDEX_IDX_ADD_RRR) decoded.opcodeIndex = OPCODE_INDEX_IDX_UNCHECKED_ADD_RRR;
+						unchecked = true;
+					} else if (program[i].rawValue == SET && word(i+1).rawValue == ByteCode(ARRAY_INDEX, ARRAY_INDEX_NONE).rawValue && word(i+2).rawValue == index.rawValue && word(i+3).rawValue == array.rawValue && (word(i+4).type == RAM_VAR_NUMERIC || word(i+4).type == ROM_CONST_NUMERIC) && word(i+5).type == VOID) {
+						if (dispatch_program_checked.empty()) dispatch_program_checked = dispatch_program;
+						decoded.opcodeIndex = word(i+4).type == RAM_VAR_NUMERIC? OPCODE_INDEX_SET_UNCHECKED_R : OPCODE_INDEX_SET_UNCHECKED_C;
+						unchecked = true;
+					}
+				}
+				if (unchecked) indexedLoops.push_back({begin, head, end, index, count, array});
+			}
 		}
 		
-		void Write(std::ostream& s) {
+		void Write(std::ostream& s) const {
 			{// Write Header
 				// Write assembly file info
 				s << parserFiletype << ' ' << parserVersionMajor << ' ' << parserVersionMinor << ' ' << XC_APP_NAME << ' ' << XC_APP_VERSION << '\n';
 				
 				// Write device compatibility info
 				s << GetDeviceObjectsList() << '\n';
-				for (auto&[name, o] : Device::objectTypesByName) {
+				for (auto&[name, o] : context->objectTypesByName) {
 					s << std::to_string(uint32_t(o.id)) << ' ' << GetDeviceFunctionsList(o.id) << '\n';
 				}
 				s << "0 " << GetDeviceFunctionsList(0) << '\n';
@@ -5470,6 +7972,20 @@ const int VERSION_PATCH = 0;
 					s << '\n';
 				}
 				
+				// Write debug info
+				for (const DebugInfo* debug : {&debug_vars_init, &debug_program}) {
+					s << debug->lines.size() << ' ' << debug->files.size() << ' ' << debug->inlinedCalls.size() << '\n';
+					for (auto&[addr, line] : debug->lines) {
+						s << addr << ' ' << line << '\n';
+					}
+					for (auto&[addr, file] : debug->files) {
+						s << addr << ' ' << file << '\n';
+					}
+					for (auto& call : debug->inlinedCalls) {
+						s << call.begin << ' ' << call.end << ' ' << call.line << ' ' << call.sourceFile << '\n';
+					}
+				}
+				
 				// Write Rom data (constants)
 				for (auto& value : rom_numericConstants) {
 					s << ToStringHighPrecision(value) << ' ';
@@ -5626,6 +8142,27 @@ const int VERSION_PATCH = 0;
 						s >> entryPoint.args[j];
 					}
 				}
+				
+				// Read debug info
+				if (versionMinor >= 2) {
+					for (DebugInfo* debug : {&debug_vars_init, &debug_program}) {
+						size_t linesSize, filesSize, inlinedCallsSize = 0;
+						s >> linesSize >> filesSize;
+						if (versionMinor >= 3) s >> inlinedCallsSize;
+						debug->lines.resize(linesSize);
+						debug->files.resize(filesSize);
+						debug->inlinedCalls.resize(inlinedCallsSize);
+						for (auto&[addr, line] : debug->lines) {
+							s >> addr >> line;
+						}
+						for (auto&[addr, file] : debug->files) {
+							s >> addr >> file;
+						}
+						for (auto& call : debug->inlinedCalls) {
+							s >> call.begin >> call.end >> call.line >> call.sourceFile;
+						}
+					}
+				}
 
 				// Discard the \n
 				if (s.peek() == '\n') s.get();
@@ -5637,20 +8174,204 @@ const int VERSION_PATCH = 0;
 					s.get();
 					rom_numericConstants.push_back(value);
 				}
-				for (size_t i = 0; i < rom_textConstantsSize; ++i) {
-					char value[XC_MAX_TEXT_LENGTH+1];
-					s.getline(value, XC_MAX_TEXT_LENGTH, '\0');
-					rom_textConstants.push_back(value);
+				for (size_t i = 0; i < rom_textConstantsSize; ++i) {
+					char value[XC_MAX_TEXT_LENGTH+1];
+					s.getline(value, XC_MAX_TEXT_LENGTH, '\0');
+					rom_textConstants.push_back(value);
+				}
+			}
+
+			// Read vars_init bytecode
+			s.read((char*)rom_vars_init.data(), varsInitSize * sizeof(uint32_t));
+
+			// Read program bytecode
+			s.read((char*)rom_program.data(), programSize * sizeof(uint32_t));
+			
+			// Older assemblies have their debug info inlined as SOURCEFILE/LINENUMBER statements
+			if (versionMinor < 2) {
+				auto extractDebugInfo = [this](const std::vector<ByteCode>& program, DebugInfo& debug) {
+					for (uint32_t addr = 0; addr < program.size(); ++addr) {
+						if (program[addr].type == LINENUMBER) {
+							debug.AddLine(addr, program[addr].value);
+						} else if (program[addr].type == SOURCEFILE && program[addr].value < sourceFiles.size()) {
+							debug.AddFile(addr, program[addr].value);
+						}
+					}
+				};
+				extractDebugInfo(rom_vars_init, debug_vars_init);
+				extractDebugInfo(rom_program, debug_program);
+			}
+		}
+	};
+	
+	// Loaded assemblies, shared read-only by all the computers running the same compiled program against the same DeviceContext
+	class AssemblyCache {
+		std::mutex mutex {};
+		std::unordered_map<const DeviceContext*, std::unordered_map<std::string/*compiled program*/, std::weak_ptr<const Assembly>>> assemblies {};
+		
+	public:
+		std::shared_ptr<const Assembly> Load(std::istream& stream, const DeviceContext& context = GetDefaultDeviceContext()) {
+			std::string program {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+			{
+				std::lock_guard lock(mutex);
+				auto& cache = assemblies[&context];
+				if (auto it = cache.find(program); it != cache.end()) {
+					if (auto assembly = it->second.lock()) return assembly;
+				}
+			}
+			std::istringstream programStream(program, std::ios::in | std::ios::binary);
+			std::shared_ptr<const Assembly> assembly = std::make_shared<const Assembly>(programStream, context);
+			std::lock_guard lock(mutex);
+			auto& cache = assemblies[&context];
+			std::erase_if(cache, [](const auto& entry){ return entry.second.expired(); });
+			auto& cached = cache[std::move(program)];
+			if (auto existing = cached.lock()) return existing; // loaded by another thread in the meantime
+			cached = assembly;
+			return assembly;
+		}
+		
+		// Number of assemblies currently in use
+		size_t Size() {
+			std::lock_guard lock(mutex);
+			size_t size = 0;
+			for (const auto& [context, cache] : assemblies) {
+				size += std::count_if(cache.begin(), cache.end(), [](const auto& entry){ return !entry.second.expired(); });
+			}
+			return size;
+		}
+	};
+	AssemblyCache& GetSharedAssemblyCache();
+
+	// Compiled programs, keyed by the parsed source lines (all includes resolved) and the fingerprint of the DeviceContext they are compiled against
+	// Kept in memory (up to XC_COMPILE_CACHE_MAX_ENTRIES) and optionally in a directory, so that compiled programs survive a restart
+	class CompileCache {
+		struct Entry {
+			std::string key;
+			std::shared_ptr<const std::string> program;
+		};
+		std::mutex mutex {};
+		std::unordered_map<uint64_t, Entry> entries {};
+		std::deque<uint64_t> order {}; // oldest first
+		std::string directory = "";
+
+		static std::string GetKey(const std::vector<ParsedLine>& lines, const DeviceContext& context, int optimizationLevel) {
+			std::string key = std::string(XC_APP_NAME) + ' ' + std::to_string(XC_APP_VERSION) + ' ' + std::to_string(VERSION_MAJOR) + '.' + std::to_string(VERSION_MINOR) + '.' + std::to_string(VERSION_PATCH) + " O" + std::to_string(optimizationLevel) + '\n';
+			key += context.GetFingerprint();
+			for (const auto& line : lines) {
+				key += '\n' + std::to_string(line.scope) + ' ' + std::to_string(line.line);
+				for (const auto& word : line.words) {
+					key += ' ' + std::to_string(int(word.type)) + ':' + std::to_string(word.word.size()) + ':' + word.word;
+				}
+			}
+			return key;
+		}
+
+		static std::string GetFilePath(const std::string& directory, uint64_t hash) {
+			std::ostringstream s;
+			s << directory << '/' << std::hex << std::setw(16) << std::setfill('0') << hash << ".xcc";
+			return s.str();
+		}
+
+		// File format: key size (uint64_t), key, compiled program
+		static std::shared_ptr<const std::string> ReadFile(const std::string& directory, uint64_t hash, const std::string& key) {
+			std::ifstream file{GetFilePath(directory, hash), std::ios::binary};
+			if (!file) return nullptr;
+			uint64_t keySize = 0;
+			if (!file.read((char*)&keySize, sizeof(keySize)) || keySize != key.size()) return nullptr;
+			std::string fileKey(keySize, '\0');
+			if (!file.read(fileKey.data(), keySize) || fileKey != key) return nullptr;
+			return std::make_shared<const std::string>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+
+		static void WriteFile(const std::string& directory, uint64_t hash, const std::string& key, const std::string& program) {
+			std::string filepath = GetFilePath(directory, hash);
+			std::ostringstream tmp;
+			tmp << filepath << '.' << std::this_thread::get_id() << ".tmp";
+			{
+				std::ofstream file{tmp.str(), std::ios::out | std::ios::trunc | std::ios::binary};
+				uint64_t keySize = key.size();
+				file.write((const char*)&keySize, sizeof(keySize));
+				file.write(key.data(), key.size());
+				file.write(program.data(), program.size());
+				if (!file.good()) {
+					file.close();
+					std::error_code err;
+					std::filesystem::remove(tmp.str(), err);
+					return;
+				}
+			}
+			std::error_code err;
+			std::filesystem::rename(tmp.str(), filepath, err); // atomic replace, another process may be writing the same program
+			if (err) std::filesystem::remove(tmp.str(), err);
+		}
+
+		void Insert(uint64_t hash, std::string&& key, const std::shared_ptr<const std::string>& program) {
+			if (!entries.contains(hash)) {
+				order.push_back(hash);
+				while (order.size() > XC_COMPILE_CACHE_MAX_ENTRIES) {
+					entries.erase(order.front());
+					order.pop_front();
+				}
+			}
+			entries[hash] = {std::move(key), program};
+		}
+
+	public:
+		// Cache compiled programs in the given directory as well (empty string for memory only)
+		void SetDirectory(const std::string& directory_) {
+			std::lock_guard lock(mutex);
+			directory = directory_;
+			if (directory != "") {
+				std::filesystem::create_directories(directory);
+			}
+		}
+
+		// Returns the compiled program, may throw CompileError
+		// A verbose compilation always runs the compiler so that its output is printed
+		std::shared_ptr<const std::string> Compile(const std::vector<ParsedLine>& lines, bool verbose = false, const DeviceContext& context = GetDefaultDeviceContext(), int optimizationLevel = XC_OPTIMIZATION_LEVEL) {
+			std::string key = GetKey(lines, context, optimizationLevel);
+			uint64_t hash = fnv1a64(key);
+			std::string dir;
+			{
+				std::lock_guard lock(mutex);
+				if (!verbose) {
+					if (auto it = entries.find(hash); it != entries.end() && it->second.key == key) {
+						return it->second.program;
+					}
+				}
+				dir = directory;
+			}
+			std::shared_ptr<const std::string> program = nullptr;
+			if (dir != "" && !verbose) {
+				program = ReadFile(dir, hash, key);
+			}
+			if (!program) {
+				std::ostringstream stream(std::ios::out | std::ios::binary);
+				Assembly(lines, verbose, context, optimizationLevel).Write(stream);
+				program = std::make_shared<const std::string>(stream.str());
+				if (dir != "") {
+					WriteFile(dir, hash, key, *program);
 				}
 			}
+			std::lock_guard lock(mutex);
+			Insert(hash, std::move(key), program);
+			return program;
+		}
 
-			// Read vars_init bytecode
-			s.read((char*)rom_vars_init.data(), varsInitSize * sizeof(uint32_t));
+		// Number of compiled programs in memory
+		size_t Size() {
+			std::lock_guard lock(mutex);
+			return entries.size();
+		}
 
-			// Read program bytecode
-			s.read((char*)rom_program.data(), programSize * sizeof(uint32_t));
+		// Forget the compiled programs in memory (the directory is left untouched)
+		void Clear() {
+			std::lock_guard lock(mutex);
+			entries.clear();
+			order.clear();
 		}
 	};
+	CompileCache& GetSharedCompileCache();
 
 #pragma endregion
 
@@ -5671,7 +8392,8 @@ const int VERSION_PATCH = 0;
 
 	class Computer {
 		// Data
-		Assembly* assembly = nullptr;
+		const DeviceContext* context;
+		std::shared_ptr<const Assembly> assembly {}; // shared with the other computers running the same program, all per-computer state lives here in the Computer
 		std::vector<double> ram_numeric {};
 		std::vector<std::string> ram_text {};
 		std::vector<std::vector<double>> ram_numeric_arrays {};
@@ -5680,8 +8402,22 @@ const int VERSION_PATCH = 0;
 		uint32_t recursion_depth = 0;
 
 		LocalVars recursive_localvars {};
-		std::unordered_map<uint32_t, uint32_t> currentLineByAddr {};
-		std::unordered_map<uint32_t, std::string> currentFileByAddr;
+		
+		// Code that ran out of IPC during RunCycle with capability.ipcResumable, resumed by the next RunCycle
+		struct SuspendedCode {
+			const std::vector<ByteCode>* program = nullptr;
+			uint32_t index = 0; // next instruction to run
+			std::vector<uint32_t> callStack {}; // return addresses of the user function calls in progress
+		} suspended {};
+		// Inputs and entry points received while code is suspended, run after it completes so that functions still run atomically
+		struct DeferredCall {
+			std::string entryPoint {}; // empty for an input
+			uint32_t port = 0;
+			Var ref {};
+			std::vector<Var> args {};
+		};
+		std::deque<DeferredCall> deferredCalls {};
+		uint32_t runCodeDepth = 0; // RunCode may be nested when a device function runs an entry point, only the outermost one can be suspended
 
 		std::vector<double> timersLastRun {};
 
@@ -5691,6 +8427,7 @@ const int VERSION_PATCH = 0;
 			uint32_t ram = 16'000'000; // number of ram variables * their memory penalty
 			uint32_t storage = 16; // number of storage variables
 			uint32_t io = 256; // Number of input/output ports
+			bool ipcResumable = false; // when ipc is exceeded during RunCycle, suspend and resume on the next cycle instead of throwing (instructions in excess are carried over)
 		} capability;
 		
 		enum class CycleState : uint8_t {
@@ -5705,28 +8442,31 @@ const int VERSION_PATCH = 0;
 		std::unordered_map<std::string, std::vector<std::string>> storageCache {};
 		bool storageDirty = false;
 		
-		bool IsLoaded() const {return assembly;}
+		bool IsLoaded() const {return bool(assembly);}
+		std::shared_ptr<const Assembly> GetAssembly() const {return assembly;}
+		const DeviceContext& GetDeviceContext() const {return *context;}
+		bool IsSuspended() const {return suspended.program;}
 		
-		Computer() {}
+		Computer(const DeviceContext& context_ = GetDefaultDeviceContext()) : context(&context_) {}
 		virtual ~Computer() {
 			ClearAssemly();
 		}
 		
 		// Compile to bytecode and write to output stream
-		static bool CompileAssembly(std::ostream& stream, const std::vector<ParsedLine>& lines, bool verbose = false) {
-			Assembly assembly(lines, verbose);
-			assembly.Write(stream);
+		static bool CompileAssembly(std::ostream& stream, const std::vector<ParsedLine>& lines, bool verbose = false, const DeviceContext& context = GetDefaultDeviceContext(), int optimizationLevel = XC_OPTIMIZATION_LEVEL) {
+			auto program = GetSharedCompileCache().Compile(lines, verbose, context, optimizationLevel);
+			stream.write(program->data(), program->size());
 			return true;
 		}
 
 		// Compile to bytecode and save assembly
-		static bool CompileAssembly(const std::string& directory, const std::vector<ParsedLine>& lines, bool verbose = false) {
+		static bool CompileAssembly(const std::string& directory, const std::vector<ParsedLine>& lines, bool verbose = false, const DeviceContext& context = GetDefaultDeviceContext(), int optimizationLevel = XC_OPTIMIZATION_LEVEL) {
 			std::ofstream file{directory + "/" + XC_PROGRAM_EXECUTABLE, std::ios::out | std::ios::trunc | std::ios::binary};
-			CompileAssembly(file, lines, verbose);
+			CompileAssembly(file, lines, verbose, context, optimizationLevel);
 			return file.good();
 		}
 		
-		// From a saved state
+		// To a saved state, including the code suspended by capability.ipcResumable
 		virtual std::vector<uint8_t> SaveState() {
 			if (!assembly) {
 				return {};
@@ -5823,6 +8563,65 @@ const int VERSION_PATCH = 0;
 				pos += ram_objects.size() * sizeof(uint64_t);
 			}
 			
+			// Suspended code (see Capability::ipcResumable), the memory is then in the middle of its functions
+			// Only written when there is some, so that the other states keep the same format and older versions reject these with an invalid size
+			if (suspended.program || !deferredCalls.empty()) {
+				assert(!suspended.program || suspended.program == &assembly->rom_program);
+				auto write = [&](const void* data, size_t size) {
+					state.resize(pos + size);
+					if (size) memcpy(state.data() + pos, data, size);
+					pos += size;
+				};
+				auto writeSize = [&](size_t size) {
+					memsize = size;
+					write(&memsize, sizeof(memsize));
+				};
+				auto writeText = [&](std::string_view text) {
+					write(text.data(), text.size());
+					write("", 1);
+				};
+				auto writeVar = [&](const Var& var) {
+					write(&var.type, sizeof(var.type));
+					if (var.type == Var::Numeric) write(&var.numericValue, sizeof(double));
+					else if (var.type == Var::Text) writeText(var.GetText());
+					else if (var.type >= Var::Object) write(&var.addrValue, sizeof(uint64_t));
+				};
+				
+				writeSize(suspended.program? 1 : 0);
+				writeSize(suspended.index);
+				writeSize(suspended.callStack.size());
+				write(suspended.callStack.data(), suspended.callStack.size() * sizeof(uint32_t));
+				write(&currentCycleInstructions, sizeof(currentCycleInstructions));
+				
+				// Locals saved by the recursive calls in progress
+				writeSize(recursive_localvars.numeric.size());
+				write(recursive_localvars.numeric.data(), recursive_localvars.numeric.size() * sizeof(double));
+				writeSize(recursive_localvars.text.size());
+				for (const std::string& text : recursive_localvars.text) writeText(text);
+				writeSize(recursive_localvars.numeric_arrays.size());
+				for (const std::vector<double>& arr : recursive_localvars.numeric_arrays) {
+					writeSize(arr.size());
+					write(arr.data(), arr.size() * sizeof(double));
+				}
+				writeSize(recursive_localvars.text_arrays.size());
+				for (const std::vector<std::string>& arr : recursive_localvars.text_arrays) {
+					writeSize(arr.size());
+					for (const std::string& text : arr) writeText(text);
+				}
+				writeSize(recursive_localvars.objects.size());
+				write(recursive_localvars.objects.data(), recursive_localvars.objects.size() * sizeof(uint64_t));
+				
+				// Inputs and entry points received in the meantime
+				writeSize(deferredCalls.size());
+				for (const DeferredCall& call : deferredCalls) {
+					writeText(call.entryPoint);
+					writeSize(call.port);
+					writeVar(call.ref);
+					writeSize(call.args.size());
+					for (const Var& arg : call.args) writeVar(arg);
+				}
+			}
+			
 			{// Checksum (just the total size, don't need to confirm data integrity)
 				size_t totalSize = state.size() + sizeof(totalSize);
 				state.resize(pos + sizeof(totalSize));
@@ -5847,7 +8646,7 @@ const int VERSION_PATCH = 0;
 				ss.seekg(0, std::ios::beg);
 				pos += memsize;
 				ClearAssemly();
-				assembly = new Assembly(ss);
+				assembly = GetSharedAssemblyCache().Load(ss, *context);
 				if (!Bootup()) return false;
 			}
 			
@@ -5913,6 +8712,85 @@ const int VERSION_PATCH = 0;
 				pos += ram_objects.size() * sizeof(uint64_t);
 			}
 			
+			// Suspended code, when there is more than the checksum left (see SaveState)
+			if (pos + sizeof(size_t) < state.size()) {
+				auto read = [&](void* data, size_t size) {
+					if (pos + size > state.size()) throw RuntimeError("Invalid state");
+					if (size) memcpy(data, state.data() + pos, size);
+					pos += size;
+				};
+				auto readSize = [&]() -> uint32_t {
+					read(&memsize, sizeof(memsize));
+					return memsize;
+				};
+				auto readText = [&]() -> std::string {
+					std::string text;
+					while (pos < state.size() && state[pos] != '\0') {
+						text += state[pos];
+						++pos;
+					}
+					++pos;
+					return text;
+				};
+				auto readVar = [&]() -> Var {
+					Var::Type type;
+					read(&type, sizeof(type));
+					if (type == Var::Numeric) {
+						double value;
+						read(&value, sizeof(value));
+						return value;
+					}
+					if (type == Var::Text) return readText();
+					if (type >= Var::Object) {
+						uint64_t addr;
+						read(&addr, sizeof(addr));
+						return Var(type, addr);
+					}
+					return {};
+				};
+				
+				const uint32_t programSize = assembly->rom_program.size();
+				const bool isSuspended = readSize();
+				suspended.index = readSize();
+				suspended.callStack.resize(readSize());
+				if (suspended.callStack.size() > XC_MAX_CALL_DEPTH) throw RuntimeError("Invalid state");
+				read(suspended.callStack.data(), suspended.callStack.size() * sizeof(uint32_t));
+				if (isSuspended) {
+					if (suspended.index >= programSize || std::any_of(suspended.callStack.begin(), suspended.callStack.end(), [programSize](uint32_t addr){ return addr >= programSize; })) {
+						throw RuntimeError("Invalid state");
+					}
+					suspended.program = &assembly->rom_program;
+					recursion_depth = suspended.callStack.size(); // see ClearAssemly
+				}
+				read(&currentCycleInstructions, sizeof(currentCycleInstructions));
+				
+				recursive_localvars.numeric.resize(readSize());
+				read(recursive_localvars.numeric.data(), recursive_localvars.numeric.size() * sizeof(double));
+				recursive_localvars.text.resize(readSize());
+				for (std::string& text : recursive_localvars.text) text = readText();
+				recursive_localvars.numeric_arrays.resize(readSize());
+				for (std::vector<double>& arr : recursive_localvars.numeric_arrays) {
+					arr.resize(readSize());
+					read(arr.data(), arr.size() * sizeof(double));
+				}
+				recursive_localvars.text_arrays.resize(readSize());
+				for (std::vector<std::string>& arr : recursive_localvars.text_arrays) {
+					arr.resize(readSize());
+					for (std::string& text : arr) text = readText();
+				}
+				recursive_localvars.objects.resize(readSize());
+				read(recursive_localvars.objects.data(), recursive_localvars.objects.size() * sizeof(uint64_t));
+				
+				for (uint32_t count = readSize(); count > 0; --count) {
+					DeferredCall& call = deferredCalls.emplace_back();
+					call.entryPoint = readText();
+					call.port = readSize();
+					call.ref = readVar();
+					call.args.resize(readSize());
+					for (Var& arg : call.args) arg = readVar();
+				}
+			}
+			
 			{// Checksum (just the total size, don't need to confirm data integrity)
 				size_t totalSize;
 				memcpy(&totalSize, state.data() + pos, sizeof(totalSize));
@@ -5922,16 +8800,22 @@ const int VERSION_PATCH = 0;
 				}
 			}
 			
-			recursion_depth = 0;
-			
 			// Ready
 			return true;
 		}
 
-		// From an input stream
+		// From an input stream, the assembly is shared with the other computers that loaded the same compiled program (see AssemblyCache)
 		virtual bool LoadProgram(std::istream& stream) {
 			ClearAssemly();
-			assembly = new Assembly(stream);
+			assembly = GetSharedAssemblyCache().Load(stream, *context);
+			return Bootup();
+		}
+		
+		// From an already loaded assembly, that must have been loaded against the same DeviceContext
+		virtual bool LoadProgram(std::shared_ptr<const Assembly> assembly_) {
+			ClearAssemly();
+			if (!assembly_ || assembly_->context != context) return false;
+			assembly = std::move(assembly_);
 			return Bootup();
 		}
 		
@@ -5941,11 +8825,13 @@ const int VERSION_PATCH = 0;
 			return LoadProgram(file);		
 		}
 		
-		// From a source code
+		// From a source code (see CompileCache)
 		virtual bool LoadProgram(const std::vector<ParsedLine>& lines, bool verbose = false) {
 			
 			ClearAssemly();
-			assembly = new Assembly(lines, verbose);
+			auto program = GetSharedCompileCache().Compile(lines, verbose, *context);
+			std::istringstream stream(*program, std::ios::in | std::ios::binary);
+			assembly = GetSharedAssemblyCache().Load(stream, *context);
 			
 			return Bootup();
 		}
@@ -5999,9 +8885,6 @@ const int VERSION_PATCH = 0;
 			timersLastRun.resize(assembly->timers.size());
 			
 			recursion_depth = 0;
-
-			currentFileByAddr.clear();
-			currentLineByAddr.clear();
 			
 			for (const auto& name : assembly->storageRefs) {
 				storageCache.try_emplace(name, std::vector<std::string>{});
@@ -6011,10 +8894,13 @@ const int VERSION_PATCH = 0;
 		}
 		
 		void ClearAssemly() {
-			if (assembly) {
-				delete assembly;
-				assembly = nullptr;
+			assembly.reset();
+			if (suspended.program) {
+				recursion_depth -= suspended.callStack.size();
+				suspended = {};
 			}
+			recursive_localvars = {};
+			deferredCalls.clear();
 			cycleState = CycleState::NONE;
 		}
 		
@@ -6183,6 +9069,13 @@ const int VERSION_PATCH = 0;
 				default: throw RuntimeError("Invalid memory reference");
 			}
 		}
+		void MemSetText(const Var& value, ByteCode dst) {
+			if (value.type == Var::Text && value.textSize == Var::SHARED_TEXT) {
+				MemSet(value.textShared->value, dst);
+			} else {
+				MemSet(std::string(value.GetText()), dst);
+			}
+		}
 		void MemSet(const std::string& value, ByteCode dst, uint32_t arrIndex = ARRAY_INDEX_NONE) {
 			if (value.length() > XC_MAX_TEXT_LENGTH) {
 				throw RuntimeError("Text too large");
@@ -6433,7 +9326,7 @@ const int VERSION_PATCH = 0;
 			return true;
 		}
 		
-		void RunCode(const std::vector<ByteCode>& program, uint32_t index = 0);
+		void RunCode(const std::vector<ByteCode>& program, uint32_t index = 0, bool resume = false);
 		
 	public:
 		bool HasTick() {
@@ -6456,7 +9349,7 @@ const int VERSION_PATCH = 0;
 				RunCode(assembly->rom_vars_init);
 				if (assembly->functionRefs.contains("system.init")) {
 					cycleState = CycleState::SYSTEM_INIT;
-					RunCode(assembly->rom_program, assembly->functionRefs["system.init"]);
+					RunCode(assembly->rom_program, assembly->functionRefs.at("system.init"));
 				}
 				return true;
 			}
@@ -6466,12 +9359,32 @@ const int VERSION_PATCH = 0;
 		void RunCycle() {
 			cycleState = CycleState::RUN;
 			assert(assembly);
-			currentCycleInstructions = 0;
+			if (capability.ipcResumable && currentCycleInstructions > capability.ipc) {
+				currentCycleInstructions -= capability.ipc;
+			} else {
+				currentCycleInstructions = 0;
+			}
 			double time = GetCurrentTimestamp();
 			
+			// Resume the code suspended during a previous cycle, the rest of that cycle is not run again
+			if (suspended.program) {
+				RunCode(*suspended.program, suspended.index, true);
+				if (suspended.program) return;
+			}
+			
+			// Inputs and entry points deferred while it was suspended, in the order they were received
+			while (!deferredCalls.empty()) {
+				DeferredCall call = std::move(deferredCalls.front());
+				deferredCalls.pop_front();
+				if (call.entryPoint.empty()) RunInput(call.port, call.args);
+				else RunEntryPointInternal(std::move(call.entryPoint), call.ref, call.args);
+				if (suspended.program) return;
+			}
+			
 			// Tick
 			if (assembly->functionRefs.contains("system.tick")) {
-				RunCode(assembly->rom_program, assembly->functionRefs["system.tick"]);
+				RunCode(assembly->rom_program, assembly->functionRefs.at("system.tick"));
+				if (suspended.program) return;
 			}
 			
 			// Timers
@@ -6481,13 +9394,18 @@ const int VERSION_PATCH = 0;
 				if (lastRun + interval < time) {
 					RunCode(assembly->rom_program, assembly->timers[i].addr);
 					timersLastRun[i] = time;
+					if (suspended.program) return;
 				}
 			}
 		}
 		
 		void RunInput(uint32_t port, const std::vector<Var>& args) {
 			if (assembly->inputs.contains(port)) {
-				auto& input = assembly->inputs[port];
+				if (suspended.program) {
+					deferredCalls.push_back({"", port, {}, args});
+					return;
+				}
+				auto& input = assembly->inputs.at(port);
 				
 				// Write args
 				for (size_t i = 0; i < args.size(); ++i) {
@@ -6497,9 +9415,9 @@ const int VERSION_PATCH = 0;
 					if (IsNumeric(dst) && arg.type == Var::Numeric) {
 						MemSet(arg.numericValue, dst);
 					} else if (IsText(dst) && arg.type == Var::Text) {
-						MemSet(arg.textValue, dst);
+						MemSetText(arg, dst);
 					} else if (IsNumeric(dst) && arg.type == Var::Text) {
-						MemSet(arg.textValue, dst);
+						MemSetText(arg, dst);
 					} else if (IsText(dst) && arg.type == Var::Numeric) {
 						MemSet(arg.numericValue, dst);
 					} else if (IsObject(dst) && arg.type == Var::Object) {
@@ -6532,6 +9450,12 @@ const int VERSION_PATCH = 0;
 			}
 			bool found = false;
 			strtolower(name);
+			// Arguments are not written back when deferred (see DeferredCall)
+			if (suspended.program && runCodeDepth == 0) {
+				found = HasEntryPoint(name, ref);
+				if (found) deferredCalls.push_back({name, 0, ref, args});
+				return found;
+			}
 			for (const auto& entryPoint : assembly->entryPoints) {
 				if (entryPoint.name == name && EntryPointMatches(entryPoint, ref)) {
 					found = true;
@@ -6544,7 +9468,7 @@ const int VERSION_PATCH = 0;
 						if (IsNumeric(dst) && arg.type == Var::Numeric) {
 							MemSet(arg.numericValue, dst);
 						} else if (IsText(dst) && arg.type == Var::Text) {
-							MemSet(arg.textValue, dst);
+							MemSetText(arg, dst);
 						} else if (IsObject(dst) && arg.type == Var::Object) {
 							MemSetObject(arg.addrValue, dst); // Reference assignment for objects
 						} else {
@@ -6603,6 +9527,277 @@ const int VERSION_PATCH = 0;
 			return RunEntryPoint(std::move(name), ref, refVector);
 		}
 		
+		// DeviceFunctionThunk of a device function declared with the native signature R(Computer*, Args...)
+		template<typename R, typename... Args>
+		static void TypedDeviceFunctionThunk(Computer* computer, const void* function, const ByteCode* args, ByteCode dst) {
+			const auto& func = *static_cast<const std::function<R(Computer*, Args...)>*>(function);
+			auto call = [&]<size_t... I>(std::index_sequence<I...>) -> R {
+				return func(computer, computer->TypedDeviceFunctionArg<Args>(args[I])...);
+			};
+			if constexpr (std::is_void_v<R>) {
+				call(std::index_sequence_for<Args...>{});
+			} else if constexpr (std::is_same_v<R, double>) {
+				double ret = call(std::index_sequence_for<Args...>{});
+				if (__builtin_expect(dst.type == RAM_VAR_NUMERIC, 1)) {
+					computer->ram_numeric[dst.value] = ret;
+				} else if (dst && dst != DISCARD) {
+					computer->MemSet(ret, dst);
+				}
+			} else {
+				std::string ret = call(std::index_sequence_for<Args...>{});
+				if (dst && dst != DISCARD) {
+					computer->MemSet(ret, dst);
+				}
+			}
+		}
+		
+	private:
+		template<typename T>
+		T TypedDeviceFunctionArg(ByteCode ref) {
+			if constexpr (std::is_same_v<T, double>) {
+				if (__builtin_expect(ref.type == RAM_VAR_NUMERIC, 1)) return ram_numeric[ref.value];
+				return MemGetNumeric(ref);
+			} else {
+				return MemGetText(ref);
+			}
+		}
+		
+	};
+	
+	// Implementation MAY declare (or override) device functions with a native signature, like DeclareDeviceFunction<double(Computer*, double, double)>("add($a:number, $b:number):number", ...)
+	// Arguments may be double (number) or std::string_view (text) and the return type may be void, double (number) or std::string (text), matching the prototype.
+	// Call sites whose arguments already have the right types call it directly, others go through a regular DeviceFunction wrapper.
+	template<typename Signature> struct TypedDeviceFunctionTraits;
+	template<typename R, typename... Args>
+	struct TypedDeviceFunctionTraits<R(Computer*, Args...)> {
+		static_assert(std::is_void_v<R> || std::is_same_v<R, double> || std::is_same_v<R, std::string>, "Typed device functions must return void, double or std::string");
+		static_assert(((std::is_same_v<Args, double> || std::is_same_v<Args, std::string_view>) && ...), "Typed device function arguments must be double or std::string_view");
+		using Function = std::function<R(Computer*, Args...)>;
+		static constexpr const char* returnType = std::is_void_v<R>? "" : std::is_same_v<R, double>? "number" : "text";
+		static Var Call(const Function& func, Computer* computer, const std::vector<Var>& args) {
+			auto call = [&]<size_t... I>(std::index_sequence<I...>) -> R {
+				// Text arguments are copied into a tuple so that the string_views outlive the call
+				std::tuple<std::conditional_t<std::is_same_v<Args, double>, double, std::string>...> values {(I < args.size()? args[I] : Var{}) ...};
+				return func(computer, Args(std::get<I>(values))...);
+			};
+			if constexpr (std::is_void_v<R>) {
+				call(std::index_sequence_for<Args...>{});
+				return {};
+			} else {
+				return call(std::index_sequence_for<Args...>{});
+			}
+		}
+	};
+	template<typename Signature, typename F>
+	DeviceContext::FunctionInfo& DeviceContext::DeclareDeviceFunction(const std::string& prototype, F&& func, uint8_t base) {
+		using Traits = TypedDeviceFunctionTraits<Signature>;
+		auto typed = std::make_shared<const typename Traits::Function>(std::forward<F>(func));
+		FunctionInfo& f = DeclareDeviceFunction(prototype, [typed](Computer* computer, const std::vector<Var>& args) -> Var {
+			return Traits::Call(*typed, computer, args);
+		}, base);
+		assert(f.returnType == Traits::returnType);
+		TypedFunction& slot = deviceFunctionTypedVectors[(f.id >> 16) & 0xFF][(f.id & 0xFFFF) - 1];
+		[&]<typename R, typename... Args>(std::type_identity<R(Computer*, Args...)>) {
+			slot.args = {(std::is_same_v<Args, double>? Var::Numeric : Var::Text)...};
+			slot.thunk = &Computer::TypedDeviceFunctionThunk<R, Args...>;
+		}(std::type_identity<Signature>{});
+		assert(slot.args.size() == f.args.size());
+		for (size_t i = 0; i < f.args.size(); ++i) {
+			assert(f.args[i].type == (slot.args[i] == Var::Numeric? "number" : "text"));
+		}
+		slot.function = typed;
+		return f;
+	}
+	template<typename Signature, typename F>
+	inline static DeviceContext::FunctionInfo& DeclareDeviceFunction(const std::string& prototype, F&& func, uint8_t base = 0) {
+		return GetDefaultDeviceContext().DeclareDeviceFunction<Signature>(prototype, std::forward<F>(func), base);
+	}
+
+#pragma endregion
+
+#pragma region ComputerPool
+
+	// Runs the cycles and queued inputs of many computers across a work-stealing thread pool.
+	// Threading contract:
+	//   - A computer is only ever run by one thread at a time, each of its functions still executes atomically
+	//   - Device functions, object members and the output function are called from the pool's threads (including the one calling RunCycle),
+	//     concurrently for different computers, so they must be thread-safe unless they only touch the state of the computer they are given
+	//   - Add, Remove and GetStats must not be called during RunCycle, QueueInput may be called from any thread at any time
+	class ComputerPool {
+	public:
+		struct Stats {
+			uint64_t cycles = 0;
+			uint64_t lastCycleInstructions = 0; // IPC of the last cycle including its inputs, only counted when capability.ipc > 0
+			double lastCycleTime = 0; // seconds spent in the last cycle including its inputs
+			double totalTime = 0;
+			std::string error = ""; // set when the computer crashed, it is not run anymore until removed and added again
+		};
+		
+	private:
+		struct Entry {
+			Computer* computer;
+			std::mutex inputsMutex {};
+			std::vector<std::pair<uint32_t, std::vector<Var>>> inputs {};
+			Stats stats {};
+		};
+		struct WorkQueue {
+			std::mutex mutex {};
+			std::deque<Entry*> tasks {};
+		};
+		
+		std::vector<std::unique_ptr<Entry>> entries {};
+		std::unordered_map<const Computer*, Entry*> entriesByComputer {};
+		std::vector<std::unique_ptr<WorkQueue>> queues {}; // one per worker thread, the last one belongs to the thread calling RunCycle
+		std::vector<std::thread> threads {};
+		
+		std::mutex cycleMutex {};
+		std::condition_variable cycleStart {};
+		std::condition_variable cycleEnd {};
+		uint64_t cycleId = 0;
+		bool stopping = false;
+		std::atomic<size_t> remainingTasks = 0;
+		
+		// Computers are run from the back of their own queue and stolen from the front of the others
+		Entry* NextTask(size_t queueIndex) {
+			{
+				WorkQueue& own = *queues[queueIndex];
+				std::lock_guard lock(own.mutex);
+				if (!own.tasks.empty()) {
+					Entry* entry = own.tasks.back();
+					own.tasks.pop_back();
+					return entry;
+				}
+			}
+			for (size_t i = 1; i < queues.size(); ++i) {
+				WorkQueue& victim = *queues[(queueIndex + i) % queues.size()];
+				std::lock_guard lock(victim.mutex);
+				if (!victim.tasks.empty()) {
+					Entry* entry = victim.tasks.front();
+					victim.tasks.pop_front();
+					return entry;
+				}
+			}
+			return nullptr;
+		}
+		
+		void RunTasks(size_t queueIndex) {
+			while (Entry* entry = NextTask(queueIndex)) {
+				RunEntry(*entry);
+				if (remainingTasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					std::lock_guard lock(cycleMutex);
+					cycleEnd.notify_all();
+				}
+			}
+		}
+		
+		void RunEntry(Entry& entry) {
+			std::vector<std::pair<uint32_t, std::vector<Var>>> inputs;
+			{
+				std::lock_guard lock(entry.inputsMutex);
+				inputs.swap(entry.inputs);
+			}
+			auto start = std::chrono::steady_clock::now();
+			try {
+				entry.computer->RunCycle();
+				for (const auto& [port, args] : inputs) {
+					entry.computer->RunInput(port, args);
+				}
+			} catch (std::exception& e) {
+				entry.stats.error = e.what();
+			}
+			entry.stats.lastCycleTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			entry.stats.totalTime += entry.stats.lastCycleTime;
+			entry.stats.lastCycleInstructions = entry.computer->currentCycleInstructions;
+			entry.stats.cycles++;
+		}
+		
+		void WorkerLoop(size_t queueIndex) {
+			uint64_t lastCycleId = 0;
+			for (;;) {
+				{
+					std::unique_lock lock(cycleMutex);
+					cycleStart.wait(lock, [&]{ return stopping || cycleId != lastCycleId; });
+					if (stopping) return;
+					lastCycleId = cycleId;
+				}
+				RunTasks(queueIndex);
+			}
+		}
+		
+	public:
+		// threadCount includes the thread calling RunCycle
+		ComputerPool(size_t threadCount = std::thread::hardware_concurrency()) {
+			threadCount = std::max<size_t>(threadCount, 1);
+			for (size_t i = 0; i < threadCount; ++i) {
+				queues.emplace_back(std::make_unique<WorkQueue>());
+			}
+			for (size_t i = 0; i + 1 < threadCount; ++i) {
+				threads.emplace_back(&ComputerPool::WorkerLoop, this, i);
+			}
+		}
+		ComputerPool(const ComputerPool&) = delete;
+		ComputerPool& operator=(const ComputerPool&) = delete;
+		~ComputerPool() {
+			{
+				std::lock_guard lock(cycleMutex);
+				stopping = true;
+			}
+			cycleStart.notify_all();
+			for (auto& thread : threads) {
+				thread.join();
+			}
+		}
+		
+		// The computer must have a loaded program and stay alive until removed
+		void Add(Computer* computer) {
+			assert(computer && !entriesByComputer.contains(computer));
+			auto& entry = entries.emplace_back(std::make_unique<Entry>());
+			entry->computer = computer;
+			entriesByComputer.emplace(computer, entry.get());
+		}
+		
+		void Remove(Computer* computer) {
+			entriesByComputer.erase(computer);
+			std::erase_if(entries, [computer](const auto& entry){ return entry->computer == computer; });
+		}
+		
+		// The input is run after the next cycle of that computer
+		void QueueInput(Computer* computer, uint32_t port, std::vector<Var> args) {
+			Entry* entry = entriesByComputer.at(computer);
+			std::lock_guard lock(entry->inputsMutex);
+			entry->inputs.emplace_back(port, std::move(args));
+		}
+		
+		const Stats& GetStats(const Computer* computer) const {
+			return entriesByComputer.at(computer)->stats;
+		}
+		
+		size_t GetThreadCount() const {
+			return queues.size();
+		}
+		
+		// Runs one cycle of every computer that has not crashed, followed by its queued inputs, and waits for all of them to finish
+		void RunCycle() {
+			size_t count = std::count_if(entries.begin(), entries.end(), [](const auto& entry){ return entry->stats.error == ""; });
+			if (count == 0) return;
+			// Set before queueing, a worker still leaving the previous cycle may already pick up a task
+			remainingTasks.store(count, std::memory_order_release);
+			size_t next = 0;
+			for (auto& entry : entries) {
+				if (entry->stats.error != "") continue;
+				WorkQueue& queue = *queues[next++ % queues.size()];
+				std::lock_guard lock(queue.mutex);
+				queue.tasks.push_back(entry.get());
+			}
+			{
+				std::lock_guard lock(cycleMutex);
+				++cycleId;
+			}
+			cycleStart.notify_all();
+			RunTasks(queues.size() - 1);
+			std::unique_lock lock(cycleMutex);
+			cycleEnd.wait(lock, [&]{ return remainingTasks.load(std::memory_order_acquire) == 0; });
+		}
 	};
 
 #pragma endregion
@@ -6613,54 +9808,98 @@ const int VERSION_PATCH = 0;
 
 	namespace XC_NAMESPACE {
 		
-		std::unordered_map<std::string, double> Implementation::globalNumericConstants;
-		std::unordered_map<std::string, std::string> Implementation::globalTextConstants;
-		std::vector<std::string> Implementation::entryPoints {};
-		std::unordered_map<std::string, ObjectType> Device::objectTypesByName {};
-		std::unordered_map<uint8_t, std::string> Device::objectNamesById {};
-		std::vector<std::string> Device::objectTypesList {};
-		std::unordered_map<std::string, Device::FunctionInfo> Device::deviceFunctionsByName {};
-		std::unordered_map<uint32_t/*24 least significant bits only*/, std::string> Device::deviceFunctionNamesById {};
-		std::unordered_map<uint32_t/*24 least significant bits only*/, DeviceFunction> Device::deviceFunctionsById {};
-		std::unordered_map<uint32_t/*24 least significant bits only*/, bool> Device::deviceFunctionHasReturn {};
-		std::unordered_map<uint8_t, std::vector<std::string>> Device::deviceFunctionsList {};
-		std::vector<std::vector<DeviceFunction*>> Device::deviceFunctionVectors(128); // Pre-allocate for 128 bases
-		std::vector<std::vector<bool>> Device::deviceFunctionHasReturnVectors(128);
-		OutputFunction Device::outputFunction = [](Computer*, uint32_t, const std::vector<Var>&){};
+		DeviceContext& GetDefaultDeviceContext() {
+			static DeviceContext context {};
+			return context;
+		}
+		AssemblyCache& GetSharedAssemblyCache() {
+			static AssemblyCache cache {};
+			return cache;
+		}
+		CompileCache& GetSharedCompileCache() {
+			static CompileCache cache {};
+			return cache;
+		}
 	
-		void Computer::RunCode(const std::vector<ByteCode>& program, uint32_t index) {
+		void Computer::RunCode(const std::vector<ByteCode>& program, uint32_t index, bool resume) {
 			if (!assembly) return;
 			if (program.size() <= index) return;
 			
-			// Find current file and line for debug
-			std::string_view currentFile = currentFileByAddr[index];
-			uint32_t currentLine = currentLineByAddr[index];
-			for (int32_t tmpIndex = index; tmpIndex >= 0; --tmpIndex) {
-				if (currentLine == 0 && program[tmpIndex].type == LINENUMBER) {
-					currentLine = program[tmpIndex].value;
-					currentLineByAddr[index] = currentLine;
-				} else if (currentFile == "" && program[tmpIndex].type == SOURCEFILE) {
-					if (program[tmpIndex].value < assembly->sourceFiles.size()) {
-						currentFile = assembly->sourceFiles[program[tmpIndex].value];
-						currentFileByAddr[index] = currentFile;
-					}
-				} else if (currentLine != 0 && currentFile != "") {
-					break;
+			++runCodeDepth;
+			struct RunCodeDepthGuard {
+				uint32_t& depth;
+				~RunCodeDepthGuard() {--depth;}
+			} runCodeDepthGuard {runCodeDepth};
+			
+			// User function calls (JMP) push their return address here instead of recursing into RunCode, bounded by XC_MAX_CALL_DEPTH
+			uint32_t callStack[XC_MAX_CALL_DEPTH];
+			uint32_t callDepth = 0;
+			auto returnFromCall = [&]() __attribute__((always_inline)) {
+				index = callStack[--callDepth];
+				assert(recursion_depth > 0);
+				recursion_depth--;
+			};
+			
+			// Resume the suspended code (see SUSPEND below)
+			bool checkedIndexing = false;
+			if (resume) {
+				assert(&program == suspended.program && suspended.callStack.size() <= XC_MAX_CALL_DEPTH);
+				callDepth = suspended.callStack.size();
+				std::copy(suspended.callStack.begin(), suspended.callStack.end(), callStack);
+				suspended = {};
+				// Other code may have changed the index, the count or the array of the loops we are resuming in, then keep checking their accesses until the end of this run
+				if (&program == &assembly->rom_program) for (const IndexedLoop& loop : assembly->indexedLoops) {
+					if (index <= loop.begin || index >= loop.end) continue;
+					const double i = ram_numeric[loop.index.value], count = ram_numeric[loop.count.value];
+					if (index <= loop.head || i < 0 || i != std::nearbyint(i) || count > ram_numeric_arrays[loop.array.value].size() || (index > loop.head + 3 && i >= count)) {
+						checkedIndexing = true;
+					}
 				}
 			}
 			
 			// IPC check - only enabled when capability.ipc > 0
 			const bool ipcEnabled = capability.ipc > 0;
-			auto ipcCheck = [this, ipcEnabled](int ipcPenalty = 1) __attribute__((always_inline)) {
+			// Resumable IPC, the code is suspended before the first instruction that starts when the budget is exhausted, penalties within an instruction are only counted
+			const bool ipcSuspendable = ipcEnabled && capability.ipcResumable && cycleState == CycleState::RUN && runCodeDepth == 1 && !suspended.program;
+			// Other runs of a resumable computer, such as entry points called by device functions, get a budget of their own instead of what is left of the cycle, their instructions are still counted in it
+			struct CycleInstructionsGuard {
+				uint64_t& count;
+				uint64_t outer;
+				~CycleInstructionsGuard() {count += outer;}
+			} cycleInstructionsGuard {currentCycleInstructions, (ipcEnabled && capability.ipcResumable && !ipcSuspendable)? std::exchange(currentCycleInstructions, 0) : 0};
+			auto ipcCheck = [this, ipcEnabled, ipcSuspendable](int ipcPenalty = 1) __attribute__((always_inline)) {
 				if (__builtin_expect(ipcEnabled, 0)) { // IPC limiting is rare
 					currentCycleInstructions += ipcPenalty;
-					if (__builtin_expect(currentCycleInstructions > capability.ipc, 0)) {
+					if (__builtin_expect(currentCycleInstructions > capability.ipc, 0) && !ipcSuspendable) {
 						throw RuntimeError("Maximum IPC exceeded");
 					}
 				}
 			};
 
 			const size_t programSize = program.size(); // Cache size to avoid repeated calls
+			
+			// Where the error happened, followed by each caller up the call stack, file and line are only looked up here
+			const DebugInfo& debug = (&program == &assembly->rom_program)? assembly->debug_program : assembly->debug_vars_init;
+			auto appendCallStackDebugInfo = [&](std::stringstream& str) {
+				auto append = [&](uint32_t at) {
+					std::string_view file;
+					uint32_t line;
+					debug.Get(at, assembly->sourceFiles, file, line);
+					if (file != "" && line) {
+						str << " on bytecode " << at << " in " << file << ":" << line << std::endl;
+					}
+					// The calls that the optimizer inlined, as if they had not been
+					debug.ForEachInlinedCall(at, [&](const DebugInfo::InlinedCall& call){
+						if (call.sourceFile < assembly->sourceFiles.size() && call.line) {
+							str << " on bytecode " << call.end << " in " << assembly->sourceFiles[call.sourceFile] << ":" << call.line << std::endl;
+						}
+					});
+				};
+				append(index);
+				for (uint32_t i = callDepth; i > 0; --i) {
+					append(callStack[i-1]);
+				}
+			};
 			auto nextCode = [&program, &index, programSize]() __attribute__((always_inline)) -> ByteCode {
 				if (__builtin_expect(index + 1 < programSize, 1)) {
 					return program[++index];
@@ -6679,24 +9918,86 @@ const int VERSION_PATCH = 0;
 				return MemGetNumeric(ref);
 			};
 
+			// Pre-decoded opcode indices of this program (see Assembly::Predecode)
+			const std::vector<DecodedCode>& dispatch = (&program == &assembly->rom_program)? (checkedIndexing? assembly->dispatch_program_checked : assembly->dispatch_program) : assembly->dispatch_vars_init;
+			assert(dispatch.size() == programSize);
+			
+			#if XC_COMPUTED_GOTO
+				// Dispatch table indexed by OPCODE_INDEX, jumps directly into the corresponding case of the switch below
+				static const void* const dispatchTable[OPCODE_INDEX_COUNT] = {
+					&&xc_dispatch_CORRUPTED,
+					&&xc_dispatch_RETURN,
+					&&xc_dispatch_VOID,
+					&&xc_dispatch_UNKNOWN,
+					#define XC_DISPATCH_LABEL(op) &&xc_dispatch_##op,
+					XC_OPCODE_LIST(XC_DISPATCH_LABEL)
+					XC_QUICKENED_OPCODE_LIST(XC_DISPATCH_LABEL)
+					XC_SUPERINSTRUCTION_OPCODE_LIST(XC_DISPATCH_LABEL)
+					XC_UNCHECKED_OPCODE_LIST(XC_DISPATCH_LABEL)
+					#undef XC_DISPATCH_LABEL
+				};
+				#define XC_DISPATCH_TARGET(op) xc_dispatch_##op:
+			#else
+				#define XC_DISPATCH_TARGET(op)
+			#endif
+			#define XC_DISPATCH_CASE(op) case OPCODE_INDEX_##op: XC_DISPATCH_TARGET(op)
+			
+			// Quickened numeric operations (see Assembly::Predecode), they also skip the trailing VOID
+			const double* const rom_numeric = assembly->rom_numericConstants.data();
+			#define XC_QUICKENED_OPERAND_R(ref) ram_numeric[ref.value]
+			#define XC_QUICKENED_OPERAND_C(ref) rom_numeric[ref.value]
+			#define XC_QUICKENED_VARIANT(op, A, B, expr) XC_DISPATCH_CASE(op##_R##A##B) {\
+				const ByteCode* operands = &program[index];\
+				const double a = XC_QUICKENED_OPERAND_##A(operands[2]);\
+				const double b = XC_QUICKENED_OPERAND_##B(operands[3]);\
+				index += 3;\
+				ram_numeric[operands[1].value] = (expr);\
+				++index;\
+			}break;
+			#define XC_QUICKENED_BINARY_OP(op, expr) XC_QUICKENED_VARIANT(op, R, R, expr) XC_QUICKENED_VARIANT(op, R, C, expr) XC_QUICKENED_VARIANT(op, C, R, expr) XC_QUICKENED_VARIANT(op, C, C, expr)
+			
+			// Superinstructions (see Assembly::Predecode), the second statement is charged and may suspend exactly as if it was dispatched on its own
+			#define XC_SUPERINSTRUCTION_NEXT(addr) \
+				index = (addr);\
+				if (__builtin_expect(ipcSuspendable, 0) && currentCycleInstructions >= capability.ipc) goto SUSPEND;\
+				ipcCheck();
+			#define XC_COMPARE_BRANCH_VARIANT(op, A, B, expr) XC_DISPATCH_CASE(op##_R##A##B##_CND) {\
+				const ByteCode* operands = &program[index];\
+				const double a = XC_QUICKENED_OPERAND_##A(operands[2]);\
+				const double b = XC_QUICKENED_OPERAND_##B(operands[3]);\
+				const bool val = (expr);\
+				ram_numeric[operands[1].value] = val;\
+				XC_SUPERINSTRUCTION_NEXT(index + 5)\
+				index = val? operands[6].value : operands[7].value;\
+				continue;\
+			}break;
+			#define XC_COMPARE_BRANCH_OP(op, expr) XC_COMPARE_BRANCH_VARIANT(op, R, R, expr) XC_COMPARE_BRANCH_VARIANT(op, R, C, expr) XC_COMPARE_BRANCH_VARIANT(op, C, R, expr) XC_COMPARE_BRANCH_VARIANT(op, C, C, expr)
+
 			try {
+			RESUME_AFTER_CALL:
 				while (index < programSize) {
 					const ByteCode& code = program[index];
+					#if XC_COMPUTED_GOTO
+					{
+						const uint8_t opcodeIndex = dispatch[index].opcodeIndex;
+						if (__builtin_expect(ipcSuspendable, 0) && opcodeIndex >= OPCODE_INDEX_UNKNOWN && currentCycleInstructions >= capability.ipc) goto SUSPEND;
+						ipcCheck(opcodeIndex >= OPCODE_INDEX_UNKNOWN); // only OP statements count towards the IPC
+						goto *dispatchTable[opcodeIndex];
+					}
+					#endif
 					switch (code.type) {
-						case RETURN: return;
-						case VOID: break;
-						case SOURCEFILE:{
-							if (code.value < assembly->sourceFiles.size()) {
-								currentFile = assembly->sourceFiles[code.value];
-							}
-						}break;
-						case LINENUMBER:{
-							currentLine = code.value;
+						case RETURN: XC_DISPATCH_TARGET(RETURN) {
+							if (callDepth == 0) return;
+							returnFromCall();
 						}break;
+						case SOURCEFILE: // legacy debug info, see DebugInfo
+						case LINENUMBER:
+						case VOID: XC_DISPATCH_TARGET(VOID) break;
 						case OP: {
+							if (__builtin_expect(ipcSuspendable, 0) && currentCycleInstructions >= capability.ipc) goto SUSPEND;
 							ipcCheck();
-							switch (code.rawValue) {
-								case SET: {// [ARRAY_INDEX|OBJ_KEY ifindexnone[REF_NUM]|REF_KEY] REF_DST [REF_VALUE]orZero
+							switch (dispatch[index].opcodeIndex) {
+								XC_DISPATCH_CASE(SET) {// [ARRAY_INDEX|OBJ_KEY ifindexnone[REF_NUM]|REF_KEY] REF_DST [REF_VALUE]orZero
 									ByteCode dst = nextCode();
 									// Fast path for simple numeric assignment: var = value
 									if (__builtin_expect(dst.type == RAM_VAR_NUMERIC, 1)) {
@@ -6795,7 +10096,7 @@ const int VERSION_PATCH = 0;
 										throw RuntimeError("Invalid operation");
 									}
 								}break;
-								case ADD: {// REF_DST REF_A REF_B
+								XC_DISPATCH_CASE(ADD) {// REF_DST REF_A REF_B
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6805,7 +10106,7 @@ const int VERSION_PATCH = 0;
 										MemSet(MemGetNumeric(a) + MemGetNumeric(b), dst);
 									}
 								}break;
-								case SUB: {
+								XC_DISPATCH_CASE(SUB) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6815,7 +10116,7 @@ const int VERSION_PATCH = 0;
 										MemSet(MemGetNumeric(a) - MemGetNumeric(b), dst);
 									}
 								}break;
-								case MUL: {
+								XC_DISPATCH_CASE(MUL) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6826,7 +10127,7 @@ const int VERSION_PATCH = 0;
 										MemSet(MemGetNumeric(a) * MemGetNumeric(b), dst);
 									}
 								}break;
-								case DIV: {
+								XC_DISPATCH_CASE(DIV) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6840,7 +10141,7 @@ const int VERSION_PATCH = 0;
 										MemSet(MemGetNumeric(a) / operand, dst);
 									}
 								}break;
-								case MOD: {
+								XC_DISPATCH_CASE(MOD) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6864,7 +10165,7 @@ const int VERSION_PATCH = 0;
 										}
 									}
 								}break;
-								case POW: {
+								XC_DISPATCH_CASE(POW) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6874,7 +10175,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::pow(MemGetNumeric(a), MemGetNumeric(b)), dst);
 									}
 								}break;
-								case CCT: {
+								XC_DISPATCH_CASE(CCT) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6885,7 +10186,7 @@ const int VERSION_PATCH = 0;
 										MemSet(MemGetText(a) + MemGetText(b), dst);
 									}
 								}break;
-								case AND: {
+								XC_DISPATCH_CASE(AND) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6898,7 +10199,7 @@ const int VERSION_PATCH = 0;
 										MemSet(double(MemGetBoolean(a) && MemGetBoolean(b)), dst);
 									}
 								}break;
-								case ORR: {
+								XC_DISPATCH_CASE(ORR) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6911,7 +10212,7 @@ const int VERSION_PATCH = 0;
 										MemSet(double(MemGetBoolean(a) || MemGetBoolean(b)), dst);
 									}
 								}break;
-								case XOR: {
+								XC_DISPATCH_CASE(XOR) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6924,7 +10225,7 @@ const int VERSION_PATCH = 0;
 										MemSet(double(MemGetBoolean(a) != MemGetBoolean(b)), dst);
 									}
 								}break;
-								case EQQ: {
+								XC_DISPATCH_CASE(EQQ) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6937,7 +10238,7 @@ const int VERSION_PATCH = 0;
 										MemSet(double(std::abs(MemGetNumeric(a) - MemGetNumeric(b)) < EPSILON_DOUBLE), dst);
 									} else throw RuntimeError("Invalid operation");
 								}break;
-								case NEQ: {
+								XC_DISPATCH_CASE(NEQ) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6950,7 +10251,7 @@ const int VERSION_PATCH = 0;
 										MemSet(double(std::abs(MemGetNumeric(a) - MemGetNumeric(b)) >= EPSILON_DOUBLE), dst);
 									} else throw RuntimeError("Invalid operation");
 								}break;
-								case LST: {
+								XC_DISPATCH_CASE(LST) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6960,7 +10261,7 @@ const int VERSION_PATCH = 0;
 										MemSet(MemGetNumeric(a) < MemGetNumeric(b), dst);
 									}
 								}break;
-								case GRT: {
+								XC_DISPATCH_CASE(GRT) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6970,7 +10271,7 @@ const int VERSION_PATCH = 0;
 										MemSet(MemGetNumeric(a) > MemGetNumeric(b), dst);
 									}
 								}break;
-								case LTE: {
+								XC_DISPATCH_CASE(LTE) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6980,7 +10281,7 @@ const int VERSION_PATCH = 0;
 										MemSet(MemGetNumeric(a) <= MemGetNumeric(b), dst);
 									}
 								}break;
-								case GTE: {
+								XC_DISPATCH_CASE(GTE) {
 									ByteCode dst = nextCode();
 									ByteCode a = nextCode();
 									ByteCode b = nextCode();
@@ -6990,7 +10291,7 @@ const int VERSION_PATCH = 0;
 										MemSet(MemGetNumeric(a) >= MemGetNumeric(b), dst);
 									}
 								}break;
-								case INC: {// REF_NUM
+								XC_DISPATCH_CASE(INC) {// REF_NUM
 									ByteCode ref = nextCode();
 									if (__builtin_expect(ref.type == RAM_VAR_NUMERIC, 1)) {
 										// Fast path: for loop counters, values are already integers
@@ -7000,7 +10301,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::round(MemGetNumeric(ref)) + 1.0, ref);
 									}
 								}break;
-								case DEC: {
+								XC_DISPATCH_CASE(DEC) {
 									ByteCode ref = nextCode();
 									if (__builtin_expect(ref.type == RAM_VAR_NUMERIC, 1)) {
 										double& v = ram_numeric[ref.value];
@@ -7009,7 +10310,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::round(MemGetNumeric(ref)) - 1.0, ref);
 									}
 								}break;
-								case NOT: {// REF_DST REF_VAL
+								XC_DISPATCH_CASE(NOT) {// REF_DST REF_VAL
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									// Fast path for numeric operands
@@ -7022,7 +10323,7 @@ const int VERSION_PATCH = 0;
 										MemSet(double(v == "" || v == "0"), dst);
 									} else throw RuntimeError("Invalid operation");
 								}break;
-								case FLR: {// REF_DST REF_NUM
+								XC_DISPATCH_CASE(FLR) {// REF_DST REF_NUM
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (__builtin_expect(dst.type == RAM_VAR_NUMERIC && val.type == RAM_VAR_NUMERIC, 1)) {
@@ -7031,7 +10332,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::floor(MemGetNumeric(val)), dst);
 									}
 								}break;
-								case CIL: {
+								XC_DISPATCH_CASE(CIL) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (__builtin_expect(dst.type == RAM_VAR_NUMERIC && val.type == RAM_VAR_NUMERIC, 1)) {
@@ -7040,7 +10341,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::ceil(MemGetNumeric(val)), dst);
 									}
 								}break;
-								case RND: {
+								XC_DISPATCH_CASE(RND) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (__builtin_expect(dst.type == RAM_VAR_NUMERIC && val.type == RAM_VAR_NUMERIC, 1)) {
@@ -7049,7 +10350,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::round(MemGetNumeric(val)), dst);
 									}
 								}break;
-								case SIN: {
+								XC_DISPATCH_CASE(SIN) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (__builtin_expect(dst.type == RAM_VAR_NUMERIC, 1)) {
@@ -7058,7 +10359,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::sin(MemGetNumeric(val)), dst);
 									}
 								}break;
-								case COS: {
+								XC_DISPATCH_CASE(COS) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (__builtin_expect(dst.type == RAM_VAR_NUMERIC, 1)) {
@@ -7067,7 +10368,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::cos(MemGetNumeric(val)), dst);
 									}
 								}break;
-								case TAN: {
+								XC_DISPATCH_CASE(TAN) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (__builtin_expect(dst.type == RAM_VAR_NUMERIC && val.type == RAM_VAR_NUMERIC, 1)) {
@@ -7076,17 +10377,17 @@ const int VERSION_PATCH = 0;
 										MemSet(std::tan(MemGetNumeric(val)), dst);
 									}
 								}break;
-								case ASI: {
+								XC_DISPATCH_CASE(ASI) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									MemSet(std::asin(MemGetNumeric(val)), dst);
 								}break;
-								case ACO: {
+								XC_DISPATCH_CASE(ACO) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									MemSet(std::acos(MemGetNumeric(val)), dst);
 								}break;
-								case ATA: {
+								XC_DISPATCH_CASE(ATA) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									ByteCode val2 = nextCode();
@@ -7096,7 +10397,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::atan(MemGetNumeric(val)), dst);
 									}
 								}break;
-								case ABS: {
+								XC_DISPATCH_CASE(ABS) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (__builtin_expect(dst.type == RAM_VAR_NUMERIC && val.type == RAM_VAR_NUMERIC, 1)) {
@@ -7105,13 +10406,13 @@ const int VERSION_PATCH = 0;
 										MemSet(std::abs(MemGetNumeric(val)), dst);
 									}
 								}break;
-								case FRA: {
+								XC_DISPATCH_CASE(FRA) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									double intpart;
 									MemSet(std::modf(MemGetNumeric(val), &intpart), dst);
 								}break;
-								case SQR: {
+								XC_DISPATCH_CASE(SQR) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (__builtin_expect(dst.type == RAM_VAR_NUMERIC && val.type == RAM_VAR_NUMERIC, 1)) {
@@ -7120,7 +10421,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::sqrt(MemGetNumeric(val)), dst);
 									}
 								}break;
-								case SIG: {
+								XC_DISPATCH_CASE(SIG) {
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									ByteCode defaultVal = nextCode();
@@ -7130,7 +10431,7 @@ const int VERSION_PATCH = 0;
 									else if (defaultVal) num = MemGetNumeric(defaultVal);
 									MemSet(num, dst);
 								}break;
-								case LOG: {// REF_DST REF_NUM REF_BASE
+								XC_DISPATCH_CASE(LOG) {// REF_DST REF_NUM REF_BASE
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									ByteCode base = nextCode();
@@ -7138,7 +10439,7 @@ const int VERSION_PATCH = 0;
 									if (b == 0) b = 10.0;
 									MemSet(std::log(MemGetNumeric(val)) / std::log(b), dst);
 								}break;
-								case CLP: {// REF_DST REF_NUM REF_MIN REF_MAX
+								XC_DISPATCH_CASE(CLP) {// REF_DST REF_NUM REF_MIN REF_MAX
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									ByteCode min = nextCode();
@@ -7157,7 +10458,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::clamp(MemGetNumeric(val), minVal, maxVal), dst);
 									}
 								}break;
-								case STP: {// REF_DST REF_T1 REF_T2 REF_NUM
+								XC_DISPATCH_CASE(STP) {// REF_DST REF_T1 REF_T2 REF_NUM
 									ByteCode dst = nextCode();
 									ByteCode t1 = nextCode();
 									ByteCode t2 = nextCode();
@@ -7169,7 +10470,7 @@ const int VERSION_PATCH = 0;
 										MemSet(step(MemGetNumeric(t1), MemGetNumeric(t2), MemGetNumeric(val)), dst);
 									}
 								}break;
-								case SMT: {
+								XC_DISPATCH_CASE(SMT) {
 									ByteCode dst = nextCode();
 									ByteCode t1 = nextCode();
 									ByteCode t2 = nextCode();
@@ -7182,7 +10483,7 @@ const int VERSION_PATCH = 0;
 										MemSet(smoothstep(MemGetNumeric(t1), MemGetNumeric(t2), MemGetNumeric(val)), dst);
 									}
 								}break;
-								case LRP: {
+								XC_DISPATCH_CASE(LRP) {
 									ByteCode dst = nextCode();
 									ByteCode t1 = nextCode();
 									ByteCode t2 = nextCode();
@@ -7195,7 +10496,7 @@ const int VERSION_PATCH = 0;
 										MemSet(std::lerp(MemGetNumeric(t1), MemGetNumeric(t2), MemGetNumeric(val)), dst);
 									}
 								}break;
-								case NUM: {// REF_DST REF_SRC
+								XC_DISPATCH_CASE(NUM) {// REF_DST REF_SRC
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (IsNumeric(dst) && IsText(val)) {
@@ -7203,7 +10504,7 @@ const int VERSION_PATCH = 0;
 										MemSet(ToDouble(str), dst);
 									} else throw RuntimeError("Invalid operation");
 								}break;
-								case TXT: {// REF_DST REF_SRC [REPLACEMENT_VARS ...]
+								XC_DISPATCH_CASE(TXT) {// REF_DST REF_SRC [REPLACEMENT_VARS ...]
 									//TODO: support C++20 format specifiers in the future: https://en.cppreference.com/w/cpp/utility/format/formatter#Standard_format_specification
 									ByteCode dst = nextCode();
 									ByteCode src = nextCode();
@@ -7309,168 +10610,74 @@ const int VERSION_PATCH = 0;
 										}
 									} else throw RuntimeError("Invalid operation");
 								}break;
-								case DEV: {// DEVICE_FUNCTION_INDEX RET_DST [REF_ARG ...]
-									ByteCode dev = nextCode();
-									// Fast vector-based lookup: extract base and funcIndex from ID
-									uint8_t funcBase = (dev.value >> 16) & 0xFF;
-									uint32_t funcIndex = (dev.value & 0xFFFF); // 1-based
-									if (__builtin_expect(dev.type != DEVICE_FUNCTION_INDEX || funcBase >= 128 ||
-										funcIndex == 0 || funcIndex > Device::deviceFunctionVectors[funcBase].size(), 0)) {
-										throw RuntimeError("Invalid device function");
-									}
-									DeviceFunction* funcPtr = Device::deviceFunctionVectors[funcBase][funcIndex - 1];
-									if (__builtin_expect(!funcPtr, 0)) {
+								XC_DISPATCH_CASE(DEV) {// DEVICE_FUNCTION_INDEX RET_DST [REF_ARG ...]
+									// Pre-linked call site (see Assembly::Predecode)
+									const DeviceCallSite& call = assembly->deviceCallSites[dispatch[index].link];
+									if (__builtin_expect(call.marshalling == DeviceCallSite::INVALID_FUNCTION, 0)) {
+										index = call.argsAddr;
 										throw RuntimeError("Invalid device function");
 									}
-									ByteCode dst = 0;
-									bool hasReturn = Device::deviceFunctionHasReturnVectors[funcBase][funcIndex - 1];
-									if (hasReturn) {
-										dst = nextCode();
-									}
-									ByteCode firstArg = nextCode();
-									// Fast path: no arguments, numeric return to RAM_VAR_NUMERIC
-									if (__builtin_expect(firstArg.type == VOID && hasReturn && dst.type == RAM_VAR_NUMERIC, 1)) {
-										static thread_local std::vector<Var> emptyArgs;
-										Var ret = (*funcPtr)(this, emptyArgs);
-										if (__builtin_expect(ret.type == Var::Numeric, 1)) {
-											ram_numeric[dst.value] = ret.numericValue;
-										} else if (ret.type != Var::Void) {
-											MemSet(ret.textValue, dst);
-										}
+									if (call.thunk && __builtin_expect(assembly->context->deviceFunctionTypedVectors[(call.functionId >> 16) & 0xFF][(call.functionId & 0xFFFF) - 1].function == call.typedFunction, 1)) {
+										index = call.endAddr;
+										call.thunk(this, call.typedFunction.get(), program.data() + call.argsAddr, call.dst);
 										break;
 									}
-									// Fast path: numeric arguments with numeric return to RAM_VAR_NUMERIC
-									if (__builtin_expect(hasReturn && dst.type == RAM_VAR_NUMERIC && IsNumeric(firstArg), 1)) {
-										ByteCode secondArg = nextCode();
-										if (secondArg.type == VOID) {
-											// Single numeric argument
-											static thread_local std::vector<Var> oneArg(1);
-											oneArg[0] = MemGetNumeric(firstArg);
-											Var ret = (*funcPtr)(this, oneArg);
-											if (__builtin_expect(ret.type == Var::Numeric, 1)) {
-												ram_numeric[dst.value] = ret.numericValue;
-											}
-											break;
+									// Collect arguments (use thread_local to avoid allocation)
+									static thread_local std::vector<Var> args;
+									args.clear();
+									if (__builtin_expect(call.marshalling == DeviceCallSite::NUMERIC_ARGS_TO_NUMERIC, 1)) {
+										for (uint32_t addr = call.argsAddr; addr < call.endAddr; ++addr) {
+											args.emplace_back(fastGetNumeric(program[addr]));
 										}
-										if (__builtin_expect(IsNumeric(secondArg), 1)) {
-											ByteCode thirdArg = nextCode();
-											if (thirdArg.type == VOID) {
-												// Two numeric arguments
-												static thread_local std::vector<Var> twoArgs(2);
-												twoArgs[0] = MemGetNumeric(firstArg);
-												twoArgs[1] = MemGetNumeric(secondArg);
-												Var ret = (*funcPtr)(this, twoArgs);
-												if (__builtin_expect(ret.type == Var::Numeric, 1)) {
-													ram_numeric[dst.value] = ret.numericValue;
-												}
-												break;
-											}
-											// More than 2 args - use thread_local vector
-											static thread_local std::vector<Var> manyArgs;
-											manyArgs.clear();
-											manyArgs.emplace_back(MemGetNumeric(firstArg));
-											manyArgs.emplace_back(MemGetNumeric(secondArg));
-											if (__builtin_expect(IsNumeric(thirdArg), 1)) manyArgs.emplace_back(MemGetNumeric(thirdArg));
-											else if (IsText(thirdArg)) manyArgs.emplace_back(MemGetText(thirdArg));
-											else if (IsObject(thirdArg)) manyArgs.emplace_back(MemGetObject(thirdArg));
-											else throw RuntimeError("Invalid operation");
-											for (ByteCode c; (c = nextCode()).type != VOID;) {
-												if (__builtin_expect(IsNumeric(c), 1)) manyArgs.emplace_back(MemGetNumeric(c));
-												else if (IsText(c)) manyArgs.emplace_back(MemGetText(c));
-												else if (IsObject(c)) manyArgs.emplace_back(MemGetObject(c));
-												else throw RuntimeError("Invalid operation");
+									} else {
+										const DeviceCallSite::ArgKind* argKind = assembly->deviceCallArgKinds.data() + call.argKinds;
+										for (uint32_t addr = call.argsAddr; addr < call.endAddr; ++addr, ++argKind) {
+											switch (*argKind) {
+												case DeviceCallSite::ARG_NUMERIC: args.emplace_back(MemGetNumeric(program[addr])); break;
+												case DeviceCallSite::ARG_TEXT: args.emplace_back(MemGetText(program[addr])); break;
+												case DeviceCallSite::ARG_OBJECT: args.emplace_back(MemGetObject(program[addr])); break;
+												default: index = addr; throw RuntimeError("Invalid operation");
 											}
-											Var ret = (*funcPtr)(this, manyArgs);
+										}
+									}
+									index = call.endAddr;
+									Var ret = (*call.function)(this, args);
+									const ByteCode dst = call.dst;
+									switch (call.marshalling) {
+										case DeviceCallSite::NO_ARGS_TO_NUMERIC:
 											if (__builtin_expect(ret.type == Var::Numeric, 1)) {
 												ram_numeric[dst.value] = ret.numericValue;
+											} else if (ret.type != Var::Void) {
+												MemSetText(ret, dst);
 											}
 											break;
-										}
-									}
-									// Fast path: object member access (single object arg, numeric return)
-									// This is common for $obj.property access patterns
-									if (__builtin_expect(IsObject(firstArg), 0)) {
-										ByteCode secondArg = nextCode();
-										if (__builtin_expect(secondArg.type == VOID && hasReturn && dst.type == RAM_VAR_NUMERIC, 1)) {
-											static thread_local std::vector<Var> oneObjArg(1);
-											oneObjArg[0] = MemGetObject(firstArg);
-											Var ret = (*funcPtr)(this, oneObjArg);
+										case DeviceCallSite::NUMERIC_ARGS_TO_NUMERIC:
+										case DeviceCallSite::ARGS_TO_NUMERIC:
 											if (__builtin_expect(ret.type == Var::Numeric, 1)) {
 												ram_numeric[dst.value] = ret.numericValue;
 											}
 											break;
-										}
-										// Object with more args - fall through but we already read secondArg
-										static thread_local std::vector<Var> objArgs;
-										objArgs.clear();
-										objArgs.emplace_back(MemGetObject(firstArg));
-										if (secondArg.type != VOID) {
-											if (__builtin_expect(IsNumeric(secondArg), 1)) objArgs.emplace_back(MemGetNumeric(secondArg));
-											else if (IsText(secondArg)) objArgs.emplace_back(MemGetText(secondArg));
-											else if (IsObject(secondArg)) objArgs.emplace_back(MemGetObject(secondArg));
-											else throw RuntimeError("Invalid operation");
-											for (ByteCode c; (c = nextCode()).type != VOID;) {
-												if (__builtin_expect(IsNumeric(c), 1)) objArgs.emplace_back(MemGetNumeric(c));
-												else if (IsText(c)) objArgs.emplace_back(MemGetText(c));
-												else if (IsObject(c)) objArgs.emplace_back(MemGetObject(c));
-												else throw RuntimeError("Invalid operation");
-											}
-										}
-										Var ret = (*funcPtr)(this, objArgs);
-										if (dst && dst != DISCARD && ret.type != Var::Void) {
-											if (__builtin_expect(ret.type == Var::Numeric, 1)) {
-												if (__builtin_expect(dst.type == RAM_VAR_NUMERIC, 1)) {
-													ram_numeric[dst.value] = ret.numericValue;
-												} else {
-													MemSet(ret.numericValue, dst);
-												}
-											} else if (ret.type == Var::Text) {
-												MemSet(ret.textValue, dst);
-											} else {
-												if (ret.type >= Var::Object && Device::objectNamesById.contains(ret.type & (Var::Object-1))) {
-													MemSetObject(ret.addrValue, dst);
+										default:
+											if (dst && dst != DISCARD && ret.type != Var::Void) {
+												if (__builtin_expect(ret.type == Var::Numeric, 1)) {
+													if (__builtin_expect(dst.type == RAM_VAR_NUMERIC, 1)) {
+														ram_numeric[dst.value] = ret.numericValue;
+													} else {
+														MemSet(ret.numericValue, dst);
+													}
+												} else if (ret.type == Var::Text) {
+													MemSetText(ret, dst);
 												} else {
-													throw RuntimeError("Invalid operation");
+													if (ret.type >= Var::Object && context->IsObjectType(ret.type & (Var::Object-1))) {
+														MemSetObject(ret.addrValue, dst);
+													} else {
+														throw RuntimeError("Invalid operation");
+													}
 												}
 											}
-										}
-										break;
-									}
-									// General case: collect arguments (use thread_local to avoid allocation)
-									static thread_local std::vector<Var> args;
-									args.clear();
-									if (firstArg.type != VOID) {
-										if (__builtin_expect(IsNumeric(firstArg), 1)) args.emplace_back(MemGetNumeric(firstArg));
-										else if (IsText(firstArg)) args.emplace_back(MemGetText(firstArg));
-										else if (IsObject(firstArg)) args.emplace_back(MemGetObject(firstArg));
-										else throw RuntimeError("Invalid operation");
-										for (ByteCode c; (c = nextCode()).type != VOID;) {
-											if (__builtin_expect(IsNumeric(c), 1)) args.emplace_back(MemGetNumeric(c));
-											else if (IsText(c)) args.emplace_back(MemGetText(c));
-											else if (IsObject(c)) args.emplace_back(MemGetObject(c));
-											else throw RuntimeError("Invalid operation");
-										}
-									}
-									Var ret = (*funcPtr)(this, args);
-									if (dst && dst != DISCARD && ret.type != Var::Void) {
-										if (__builtin_expect(ret.type == Var::Numeric, 1)) {
-											if (__builtin_expect(dst.type == RAM_VAR_NUMERIC, 1)) {
-												ram_numeric[dst.value] = ret.numericValue;
-											} else {
-												MemSet(ret.numericValue, dst);
-											}
-										} else if (ret.type == Var::Text) {
-											MemSet(ret.textValue, dst);
-										} else {
-											if (ret.type >= Var::Object && Device::objectNamesById.contains(ret.type & (Var::Object-1))) {
-												MemSetObject(ret.addrValue, dst);
-											} else {
-												throw RuntimeError("Invalid operation");
-											}
-										}
 									}
 								}break;
-								case OUT: {// REF_NUM [REF_ARG ...]
+								XC_DISPATCH_CASE(OUT) {// REF_NUM [REF_ARG ...]
 									ByteCode io = nextCode();
 									if (__builtin_expect(!IsNumeric(io), 0)) {
 										throw RuntimeError("Invalid output index");
@@ -7481,9 +10688,9 @@ const int VERSION_PATCH = 0;
 										if (IsNumeric(c)) outArgs.emplace_back(MemGetNumeric(c));
 										else outArgs.emplace_back(MemGetText(c));
 									}
-									Device::outputFunction(this, (uint32_t)MemGetNumeric(io), outArgs);
+									context->outputFunction(this, (uint32_t)MemGetNumeric(io), outArgs);
 								}break;
-								case APP: {// REF_ARR REF_VALUE [REF_VALUE ...]
+								XC_DISPATCH_CASE(APP) {// REF_ARR REF_VALUE [REF_VALUE ...]
 									ByteCode arr = nextCode();
 									ByteCode firstArg = nextCode();
 									if (__builtin_expect(firstArg.type == VOID, 0)) throw RuntimeError("Not enough arguments");
@@ -7552,7 +10759,7 @@ const int VERSION_PATCH = 0;
 										}break;
 									}
 								}break;
-								case CLR: {
+								XC_DISPATCH_CASE(CLR) {
 									ByteCode arr = nextCode();
 									if (!IsArray(arr)) throw RuntimeError("Not an array");
 									switch (arr.type) {
@@ -7572,7 +10779,7 @@ const int VERSION_PATCH = 0;
 										}break;
 									}
 								}break;
-								case POP: {
+								XC_DISPATCH_CASE(POP) {
 									ByteCode arr = nextCode();
 									if (!IsArray(arr)) throw RuntimeError("Not an array");
 									switch (arr.type) {
@@ -7595,7 +10802,7 @@ const int VERSION_PATCH = 0;
 										}break;
 									}
 								}break;
-								case ASC: {
+								XC_DISPATCH_CASE(ASC) {
 									ByteCode arr = nextCode();
 									if (!IsArray(arr)) throw RuntimeError("Not an array");
 									switch (arr.type) {
@@ -7628,7 +10835,7 @@ const int VERSION_PATCH = 0;
 										}break;
 									}
 								}break;
-								case DSC: {
+								XC_DISPATCH_CASE(DSC) {
 									ByteCode arr = nextCode();
 									if (!IsArray(arr)) throw RuntimeError("Not an array");
 									switch (arr.type) {
@@ -7661,7 +10868,7 @@ const int VERSION_PATCH = 0;
 										}break;
 									}
 								}break;
-								case INS: {//insert REF_ARR REF_INDEX REF_VALUE [REF_VALUE ...]
+								XC_DISPATCH_CASE(INS) {//insert REF_ARR REF_INDEX REF_VALUE [REF_VALUE ...]
 									ByteCode arr = nextCode();
 									ByteCode idx = nextCode();
 									std::vector<ByteCode> args {};
@@ -7718,7 +10925,7 @@ const int VERSION_PATCH = 0;
 										}break;
 									}
 								}break;
-								case DEL: {//erase REF_ARR REF_INDEX [REF_INDEX_END]
+								XC_DISPATCH_CASE(DEL) {//erase REF_ARR REF_INDEX [REF_INDEX_END]
 									ByteCode arr = nextCode();
 									ByteCode idx = nextCode();
 									ByteCode idx2 = nextCode();
@@ -7762,7 +10969,7 @@ const int VERSION_PATCH = 0;
 										}break;
 									}
 								}break;
-								case FLL: {//fill REF_ARR REF_QTY REF_VAL
+								XC_DISPATCH_CASE(FLL) {//fill REF_ARR REF_QTY REF_VAL
 									ByteCode arr = nextCode();
 									ByteCode qty = nextCode();
 									ByteCode val = nextCode();
@@ -7798,7 +11005,7 @@ const int VERSION_PATCH = 0;
 										}break;
 									}
 								}break;
-								case FRM: {//from REF_DST REF_VAL [REF_SEPARATOR]
+								XC_DISPATCH_CASE(FRM) {//from REF_DST REF_VAL [REF_SEPARATOR]
 									ByteCode arr = nextCode();
 									ByteCode val = nextCode();
 									ByteCode sep = nextCode();
@@ -7944,7 +11151,7 @@ const int VERSION_PATCH = 0;
 										}break;
 									}
 								}break;
-								case SIZ: {//size REF_DST (REF_ARR | REF_TXT)
+								XC_DISPATCH_CASE(SIZ) {//size REF_DST (REF_ARR | REF_TXT)
 									ByteCode dst = nextCode();
 									ByteCode ref = nextCode();
 									// Fast path for RAM_ARRAY_NUMERIC -> RAM_VAR_NUMERIC
@@ -7979,7 +11186,7 @@ const int VERSION_PATCH = 0;
 										}
 									}
 								}break;
-								case LAS: {
+								XC_DISPATCH_CASE(LAS) {
 									ByteCode dst = nextCode();
 									ByteCode ref = nextCode();
 									if (!IsArray(ref) && !IsText(ref)) throw RuntimeError("Not an array or text");
@@ -8013,7 +11220,7 @@ const int VERSION_PATCH = 0;
 										MemSet(utf8substr(text, len-1, 1), dst);
 									}
 								}break;
-								case FND: {//find REF_DST (REF_ARR | REF_TXT) REF_VAL
+								XC_DISPATCH_CASE(FND) {//find REF_DST (REF_ARR | REF_TXT) REF_VAL
 									ByteCode dst = nextCode();
 									ByteCode ref = nextCode();
 									ByteCode val = nextCode();
@@ -8054,7 +11261,7 @@ const int VERSION_PATCH = 0;
 										MemSet(pos != std::string::npos? int(utf8length(MemGetText(ref).substr(0, pos))) : -1, dst);
 									}
 								}break;
-								case CON: {//contains REF_DST (REF_ARR | REF_TXT) REF_VAL
+								XC_DISPATCH_CASE(CON) {//contains REF_DST (REF_ARR | REF_TXT) REF_VAL
 									ByteCode dst = nextCode();
 									ByteCode ref = nextCode();
 									ByteCode val = nextCode();
@@ -8092,7 +11299,7 @@ const int VERSION_PATCH = 0;
 										MemSet(pos != std::string::npos? 1 : 0, dst);
 									}
 								}break;
-								case MIN: {// REF_DST (REF_ARR | (REF_NUM [REF_NUM ...]))
+								XC_DISPATCH_CASE(MIN) {// REF_DST (REF_ARR | (REF_NUM [REF_NUM ...]))
 									ByteCode dst = nextCode();
 									ByteCode firstArg = nextCode();
 									if (__builtin_expect(firstArg.type == VOID, 0)) throw RuntimeError("Not enough arguments");
@@ -8154,7 +11361,7 @@ const int VERSION_PATCH = 0;
 									}
 									MemSet(min, dst);
 								}break;
-								case MAX: {
+								XC_DISPATCH_CASE(MAX) {
 									ByteCode dst = nextCode();
 									ByteCode firstArg = nextCode();
 									if (__builtin_expect(firstArg.type == VOID, 0)) throw RuntimeError("Not enough arguments");
@@ -8216,7 +11423,7 @@ const int VERSION_PATCH = 0;
 									}
 									MemSet(max, dst);
 								}break;
-								case AVG: {
+								XC_DISPATCH_CASE(AVG) {
 									ByteCode dst = nextCode();
 									ByteCode firstArg = nextCode();
 									if (__builtin_expect(firstArg.type == VOID, 0)) throw RuntimeError("Not enough arguments");
@@ -8283,7 +11490,7 @@ const int VERSION_PATCH = 0;
 									}
 									MemSet(total / size, dst);
 								}break;
-								case SUM: {
+								XC_DISPATCH_CASE(SUM) {
 									ByteCode dst = nextCode();
 									ByteCode firstArg = nextCode();
 									if (__builtin_expect(firstArg.type == VOID, 0)) throw RuntimeError("Not enough arguments");
@@ -8342,7 +11549,7 @@ const int VERSION_PATCH = 0;
 									}
 									MemSet(total, dst);
 								}break;
-								case MED: {
+								XC_DISPATCH_CASE(MED) {
 									ByteCode dst = nextCode();
 									std::vector<ByteCode> args {};
 									for (ByteCode c; (c = nextCode()).type != VOID;) {
@@ -8379,7 +11586,7 @@ const int VERSION_PATCH = 0;
 									}
 									MemSet(med, dst);
 								}break;
-								case SBS: {// REF_DST REF_SRC REF_START REF_LENGTH
+								XC_DISPATCH_CASE(SBS) {// REF_DST REF_SRC REF_START REF_LENGTH
 									ByteCode dst = nextCode();
 									ByteCode src = nextCode();
 									ByteCode a = nextCode();
@@ -8390,7 +11597,7 @@ const int VERSION_PATCH = 0;
 									// if (!IsText(dst)) throw RuntimeError("Invalid operation");
 									MemSet(utf8substr(text, start, len), dst);
 								}break;
-								case IDX: {// REF_DST REF_ARR|REF_TEXT ARRAY_INDEX|OBJ_KEY ifindexnone[REF_NUM]|REF_KEY
+								XC_DISPATCH_CASE(IDX) {// REF_DST REF_ARR|REF_TEXT ARRAY_INDEX|OBJ_KEY ifindexnone[REF_NUM]|REF_KEY
 									ByteCode dst = nextCode();
 									ByteCode arr = nextCode();
 									ByteCode idx = nextCode();
@@ -8509,7 +11716,7 @@ const int VERSION_PATCH = 0;
 										}
 									}
 								}break;
-								case JMP: {// ADDR
+								XC_DISPATCH_CASE(JMP) {// ADDR
 									ByteCode addr = nextCode();
 									if (__builtin_expect(addr.type != ADDR, 0)) throw RuntimeError("Invalid address");
 									recursion_depth++;
@@ -8517,17 +11724,22 @@ const int VERSION_PATCH = 0;
 									if (__builtin_expect(recursion_depth > XC_MAX_CALL_DEPTH, 0)) {
 										throw RuntimeError("Max call recursion_depth exceeded");
 									}
-									RunCode(program, addr.value);
-									assert(recursion_depth > 0);
-									recursion_depth--;
+									if (__builtin_expect(addr.value >= programSize, 0)) {
+										recursion_depth--;
+										break;
+									}
+									assert(callDepth < XC_MAX_CALL_DEPTH);
+									callStack[callDepth++] = index;
+									index = addr.value;
+									continue;
 								}break;
-								case GTO: {
+								XC_DISPATCH_CASE(GTO) {
 									ByteCode addr = nextCode();
 									if (__builtin_expect(addr.type != ADDR, 0)) throw RuntimeError("Invalid address");
 									index = addr.value;
 									continue;
 								}break;
-								case CND: {// ADDR_TRUE ADDR_FALSE REF_BOOL
+								XC_DISPATCH_CASE(CND) {// ADDR_TRUE ADDR_FALSE REF_BOOL
 									ByteCode addrTrue = nextCode();
 									ByteCode addrFalse = nextCode();
 									ByteCode ref = nextCode();
@@ -8547,7 +11759,7 @@ const int VERSION_PATCH = 0;
 									index = val? addrTrue.value : addrFalse.value;
 									continue;
 								}break;
-								case KEY: {// REF_DST REF_OBJ REF_OFFSET
+								XC_DISPATCH_CASE(KEY) {// REF_DST REF_OBJ REF_OFFSET
 									ByteCode dst = nextCode();
 									const std::string& obj = MemGetText(nextCode());
 									ByteCode offset = nextCode();
@@ -8579,7 +11791,7 @@ const int VERSION_PATCH = 0;
 										}
 									}
 								}break;
-								case STR: {
+								XC_DISPATCH_CASE(STR) {
 									uint32_t addr = nextCode().rawValue;
 									uint32_t len = nextCode().rawValue;
 									uint32_t type = nextCode().type;
@@ -8630,7 +11842,7 @@ const int VERSION_PATCH = 0;
 										 throw RuntimeError("TODO this type for self recursion");
 									}
 								}break;
-								case RST: {
+								XC_DISPATCH_CASE(RST) {
 									uint32_t addr = nextCode().rawValue;
 									uint32_t len = nextCode().rawValue;
 									uint32_t type = nextCode().type;
@@ -8669,7 +11881,7 @@ const int VERSION_PATCH = 0;
 										 throw RuntimeError("TODO this type for self recursion");
 									}
 								} break;
-								case HSH: {// REF_DST REF_SRC
+								XC_DISPATCH_CASE(HSH) {// REF_DST REF_SRC
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (IsNumeric(dst) && IsText(val)) {
@@ -8677,7 +11889,7 @@ const int VERSION_PATCH = 0;
 										MemSet((double)((int64_t)(std::hash<std::string>{}(str)) & ((1ll<<53)-1)), dst);
 									} else throw RuntimeError("Invalid text operation on non-text values");
 								}break;
-								case UPP: {// REF_DST REF_SRC
+								XC_DISPATCH_CASE(UPP) {// REF_DST REF_SRC
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (IsText(dst) && IsText(val)) {
@@ -8697,7 +11909,7 @@ const int VERSION_PATCH = 0;
 										}
 									} else throw RuntimeError("Invalid text operation on non-text values");
 								}break;
-								case LCC: {// REF_DST REF_SRC
+								XC_DISPATCH_CASE(LCC) {// REF_DST REF_SRC
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (IsText(dst) && IsText(val)) {
@@ -8717,7 +11929,7 @@ const int VERSION_PATCH = 0;
 										}
 									} else throw RuntimeError("Invalid text operation on non-text values");
 								}break;
-								case ISN: {// REF_DST REF_SRC
+								XC_DISPATCH_CASE(ISN) {// REF_DST REF_SRC
 									ByteCode dst = nextCode();
 									ByteCode val = nextCode();
 									if (IsText(val)) {
@@ -8731,7 +11943,7 @@ const int VERSION_PATCH = 0;
 										MemSet(isNum, dst);
 									} else throw RuntimeError("Invalid text operation on non-text values");
 								}break;
-								case IFF: { // REF_DST REF_BOOL REF_TRUE REF_FALSE
+								XC_DISPATCH_CASE(IFF) { // REF_DST REF_BOOL REF_TRUE REF_FALSE
 									ByteCode dst = nextCode();
 									ByteCode cond = nextCode();
 									ByteCode valTrue = nextCode();
@@ -8746,7 +11958,7 @@ const int VERSION_PATCH = 0;
 										throw RuntimeError("Invalid operation");
 									}
 								}break;
-								case RPL: { // REF_DST REF_SRC REF_OLD REF_NEW [REF_COUNT]
+								XC_DISPATCH_CASE(RPL) { // REF_DST REF_SRC REF_OLD REF_NEW [REF_COUNT]
 									ByteCode dst = nextCode();
 									ByteCode src = nextCode();
 									ByteCode oldVal = nextCode();
@@ -8783,27 +11995,125 @@ const int VERSION_PATCH = 0;
 									}
 									MemSet(text, dst);
 								} break;
+								
+								// Quickened variants
+								XC_DISPATCH_CASE(SET_RR) {
+									ram_numeric[program[index+1].value] = ram_numeric[program[index+2].value];
+									index += 3;
+								}break;
+								XC_DISPATCH_CASE(SET_RC) {
+									ram_numeric[program[index+1].value] = rom_numeric[program[index+2].value];
+									index += 3;
+								}break;
+								XC_DISPATCH_CASE(INC_R) {
+									double& v = ram_numeric[program[index+1].value];
+									v = std::nearbyint(v) + 1.0;
+									index += 2;
+								}break;
+								XC_DISPATCH_CASE(DEC_R) {
+									double& v = ram_numeric[program[index+1].value];
+									v = std::nearbyint(v) - 1.0;
+									index += 2;
+								}break;
+								XC_QUICKENED_BINARY_OP(ADD, a + b)
+								XC_QUICKENED_BINARY_OP(SUB, a - b)
+								XC_QUICKENED_BINARY_OP(MUL, a * b)
+								XC_QUICKENED_BINARY_OP(DIV, __builtin_expect(b == 0, 0)? throw RuntimeError("Division by zero") : a / b)
+								XC_QUICKENED_BINARY_OP(EQQ, std::abs(a - b) < EPSILON_DOUBLE)
+								XC_QUICKENED_BINARY_OP(NEQ, std::abs(a - b) >= EPSILON_DOUBLE)
+								XC_QUICKENED_BINARY_OP(LST, a < b)
+								XC_QUICKENED_BINARY_OP(GRT, a > b)
+								XC_QUICKENED_BINARY_OP(LTE, a <= b)
+								XC_QUICKENED_BINARY_OP(GTE, a >= b)
+								
+								// Superinstructions
+								XC_COMPARE_BRANCH_OP(EQQ, std::abs(a - b) < EPSILON_DOUBLE)
+								XC_COMPARE_BRANCH_OP(NEQ, std::abs(a - b) >= EPSILON_DOUBLE)
+								XC_COMPARE_BRANCH_OP(LST, a < b)
+								XC_COMPARE_BRANCH_OP(GRT, a > b)
+								XC_COMPARE_BRANCH_OP(LTE, a <= b)
+								XC_COMPARE_BRANCH_OP(GTE, a >= b)
+								XC_DISPATCH_CASE(GTO_INC_R) {
+									const uint32_t target = program[index+1].value;
+									XC_SUPERINSTRUCTION_NEXT(target)
+									double& v = ram_numeric[program[target+1].value];
+									v = std::nearbyint(v) + 1.0;
+									index = target + 2;
+								}break;
+								XC_DISPATCH_CASE(IDX_ADD_RRR) {
+									const ByteCode* operands = &program[index];
+									const auto& array = ram_numeric_arrays[operands[2].value];
+									const uint32_t arr_index = (int)std::round(ram_numeric[operands[4].value]);
+									ram_numeric[operands[1].value] = (arr_index < array.size())? array[arr_index] : 0.0;
+									XC_SUPERINSTRUCTION_NEXT(index + 6)
+									ram_numeric[operands[7].value] = ram_numeric[operands[8].value] + ram_numeric[operands[9].value];
+									index += 4;
+								}break;
+								
+								// Unchecked array accesses, the index is a valid integer (see Assembly::FindIndexedLoops)
+								XC_DISPATCH_CASE(IDX_UNCHECKED) {
+									const ByteCode* operands = &program[index];
+									ram_numeric[operands[1].value] = ram_numeric_arrays[operands[2].value][size_t(ram_numeric[operands[4].value])];
+									index += 5;
+								}break;
+								XC_DISPATCH_CASE(SET_UNCHECKED_R) {
+									const ByteCode* operands = &program[index];
+									ram_numeric_arrays[operands[3].value][size_t(ram_numeric[operands[2].value])] = ram_numeric[operands[4].value];
+									index += 5;
+								}break;
+								XC_DISPATCH_CASE(SET_UNCHECKED_C) {
+									const ByteCode* operands = &program[index];
+									ram_numeric_arrays[operands[3].value][size_t(ram_numeric[operands[2].value])] = rom_numeric[operands[4].value];
+									index += 5;
+								}break;
+								XC_DISPATCH_CASE(IDX_UNCHECKED_ADD_RRR) {
+									const ByteCode* operands = &program[index];
+									ram_numeric[operands[1].value] = ram_numeric_arrays[operands[2].value][size_t(ram_numeric[operands[4].value])];
+									XC_SUPERINSTRUCTION_NEXT(index + 6)
+									ram_numeric[operands[7].value] = ram_numeric[operands[8].value] + ram_numeric[operands[9].value];
+									index += 4;
+								}break;
+								
+								default: XC_DISPATCH_TARGET(UNKNOWN) break; // unknown opcodes are ignored
 							}
 						}break;
-						default: throw RuntimeError("Program Corrupted");
+						default: XC_DISPATCH_TARGET(CORRUPTED) throw RuntimeError("Program Corrupted");
 					}
 					++index;
 				}
+				// Reached the end of the program within a function call, same as a return
+				if (callDepth > 0) {
+					returnFromCall();
+					++index;
+					goto RESUME_AFTER_CALL;
+				}
+				return;
+			SUSPEND:
+				// Out of IPC, RunCycle resumes here on the next cycle
+				suspended.program = &program;
+				suspended.index = index;
+				suspended.callStack.assign(callStack, callStack + callDepth);
 			} catch (RuntimeError& err) {
 				std::stringstream str;
 				str << err.what();
-				if (currentFile != "" && currentLine) {
-					str << " on bytecode " << index << " in " << currentFile << ":" << currentLine << std::endl;
-				}
+				appendCallStackDebugInfo(str);
 				throw RuntimeError(str.str());
 			} catch (std::exception& err) {
 				std::stringstream str;
 				str << err.what();
-				if (currentFile != "" && currentLine) {
-					str << " on bytecode " << index << " in " << currentFile << ":" << currentLine << std::endl;
-				}
+				appendCallStackDebugInfo(str);
 				throw std::runtime_error(str.str());
 			}
+			
+			#undef XC_COMPARE_BRANCH_OP
+			#undef XC_COMPARE_BRANCH_VARIANT
+			#undef XC_SUPERINSTRUCTION_NEXT
+			#undef XC_QUICKENED_BINARY_OP
+			#undef XC_QUICKENED_VARIANT
+			#undef XC_QUICKENED_OPERAND_C
+			#undef XC_QUICKENED_OPERAND_R
+			#undef XC_DISPATCH_CASE
+			#undef XC_DISPATCH_TARGET
 		}
 		
 	}
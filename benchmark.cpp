@@ -117,12 +117,9 @@ void Init() {
 		return XenonCode::Var("benchmark");
 	});
 
-	XenonCode::DeclareDeviceFunction("benchmark_with_args:number(a:number, b:number)", [](XenonCode::Computer*, const vector<XenonCode::Var>& args) -> XenonCode::Var {
+	XenonCode::DeclareDeviceFunction<double(XenonCode::Computer*, double, double)>("benchmark_with_args($a:number, $b:number):number", [](XenonCode::Computer*, double a, double b) -> double {
 		deviceCallCount++;
-		if (args.size() >= 2) {
-			return double(args[0]) + double(args[1]);
-		}
-		return 0.0;
+		return a + b;
 	});
 
 	// Silent output function
@@ -8,6 +8,7 @@
 using namespace std;
 
 bool verbose = false; // Set using -verbose in the arguments
+int optimizationLevel = 1; // Set using -O0, -O1 or -O2 in the arguments
 bool isRunning = true;
 int64_t cyclesPerSecond = 0;
 
@@ -103,10 +104,11 @@ void PrintUsage() {
 	cout << "  xenoncode [-verbose] -parse-line-generic 'a line of code'" << endl;
 	cout << "    Parses a single line of code and check for syntax errors, without verifying the validity of device-specific objects/functions/entrypoints" << endl;
 	cout << endl;
-	cout << "  xenoncode [-verbose] -compile <sourcedir>" << endl;
+	cout << "  xenoncode [-verbose] [-O0|-O1|-O2] -compile <sourcedir>" << endl;
 	cout << "    Parse and Compile a program from a given directory" << endl;
 	cout << "    There must be a 'main.xc' present" << endl;
 	cout << "    It compiles into '" << XC_PROGRAM_EXECUTABLE << "' in that same given directory" << endl;
+	cout << "    -O0 disables bytecode optimizations, -O1 folds constants and removes unreachable code as well as unused functions, variables and constants, -O2 also inlines small functions, evaluates calls with constant arguments, propagates copies, reuses common subexpressions, moves loop invariants out of loops and removes dead stores (default -O1)" << endl;
 	cout << endl;
 	cout << "  xenoncode [-verbose] [-hz <NCyclesPerSecond>] -run <sourcedir>" << endl;
 	cout << "    Run a program from a given directory" << endl;
@@ -154,7 +156,7 @@ bool Compile(const string& directory) {
 			mainFile.DebugParsedLines();
 			cout << "Compiling..." << endl;
 		}
-		if (XenonCode::Computer::CompileAssembly(directory, mainFile.lines, verbose)) {
+		if (XenonCode::Computer::CompileAssembly(directory, mainFile.lines, verbose, XenonCode::GetDefaultDeviceContext(), optimizationLevel)) {
 			if (verbose) {
 				cout << "\nCompiled Successfully!\n" << endl;
 			}
@@ -267,6 +269,10 @@ int main(const int argc, const char** argv) {
 				else if (arg == "verbose") {
 					verbose = true;
 				}
+				// Optimization level
+				else if (arg == "O0" || arg == "O1" || arg == "O2") {
+					optimizationLevel = arg[1] - '0';
+				}
 				// Parse File
 				else if (arg == "parse-file") {
 					string filepath = nextArgStr();
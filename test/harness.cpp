@@ -0,0 +1,501 @@
+// Tests of the C++ API that cannot be written in XenonCode (see main.xc for the language itself)
+// From the root of this repository: g++ -std=c++20 -O2 -o build/harness test/harness.cpp && build/harness
+#define XENONCODE_IMPLEMENTATION
+#include "../XenonCode.hpp"
+
+#include <regex>
+
+using namespace std;
+using namespace XenonCode;
+
+int failures = 0;
+
+#define CHECK(condition) do {\
+	if (!(condition)) {\
+		cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << endl;\
+		++failures;\
+	}\
+} while (false)
+
+// Parsed from a main.xc in a temporary directory, so that errors report their file and line
+vector<ParsedLine> GetLines(const string& source, const DeviceContext& context = GetDefaultDeviceContext()) {
+	string directory = (filesystem::temp_directory_path() / "xenoncode_harness").string();
+	filesystem::create_directories(directory);
+	ofstream(directory + "/main.xc") << source;
+	return GetParsedFile(directory, "main.xc", context).lines;
+}
+
+// Writes the given files in a new temporary directory and returns its path
+string WriteFiles(const string& name, const map<string, string>& files) {
+	string directory = (filesystem::temp_directory_path() / name).string();
+	filesystem::remove_all(directory);
+	filesystem::create_directories(directory);
+	for (const auto& [filename, source] : files) {
+		ofstream(directory + "/" + filename) << source;
+	}
+	return directory;
+}
+
+bool SameLines(const vector<ParsedLine>& a, const vector<ParsedLine>& b) {
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (a[i].line != b[i].line || a[i].scope != b[i].scope || a[i].words.size() != b[i].words.size()) return false;
+		for (size_t w = 0; w < a[i].words.size(); ++w) {
+			if (a[i].words[w].type != b[i].words[w].type || a[i].words[w].word != b[i].words[w].word) return false;
+		}
+	}
+	return true;
+}
+
+shared_ptr<const Assembly> Compile(const vector<ParsedLine>& lines, const DeviceContext& context, int optimizationLevel) {
+	stringstream stream;
+	Computer::CompileAssembly(stream, lines, false, context, optimizationLevel);
+	return GetSharedAssemblyCache().Load(stream, context);
+}
+
+// Outputs of a context as "port:value"
+void CaptureOutputs(DeviceContext& context, vector<string>& outputs) {
+	context.SetOutputFunction([&outputs](Computer*, uint32_t port, const vector<Var>& args){
+		outputs.push_back(to_string(port) + ":" + (args.size()? string(args[0]) : ""));
+	});
+}
+
+void TestDeviceFunctionOverride() {
+	DeviceContext context;
+	vector<string> outputs;
+	CaptureOutputs(context, outputs);
+	context.DeclareDeviceFunction<double(Computer*, double)>("f($x:number):number", [](Computer*, double x){ return x + 1; });
+	auto lines = GetLines(R"(
+init
+	output.0 (f(1))
+tick
+	output.1 (f(2))
+)", context);
+	Computer computer(context);
+	CHECK(computer.LoadProgram(lines));
+	
+	// Call sites of a loaded program call the functions that override it, typed or not
+	context.DeclareDeviceFunction<double(Computer*, double)>("f($x:number):number", [](Computer*, double x){ return x * 10; });
+	computer.RunInit();
+	context.DeclareDeviceFunction("f($x:number):number", [](Computer*, const vector<Var>& args) -> Var {
+		return double(args[0]) * 100;
+	});
+	computer.RunCycle();
+	context.DeclareDeviceFunction<double(Computer*, double)>("f($x:number):number", [](Computer*, double x){ return -x; });
+	computer.RunCycle();
+	CHECK((outputs == vector<string>{"0:10", "1:200", "1:-2"}));
+}
+
+void TestResumableIpc() {
+	DeviceContext context;
+	vector<string> outputs;
+	CaptureOutputs(context, outputs);
+	context.DeclareEntryPoint("ping");
+	context.DeclareDeviceFunction("trigger", [](Computer* computer, const vector<Var>&) -> Var {
+		computer->RunEntryPoint("ping");
+		return {};
+	});
+	auto lines = GetLines(R"(
+function @sum($n:number):number
+	var $s = 0
+	repeat $n ($i)
+		$s += $i
+	return $s
+tick
+	output.0 (@sum(50))
+	trigger()
+input.0 ($n:number)
+	output.1 (@sum($n))
+ping
+	output.2 (@sum(9))
+)", context);
+	Computer computer(context);
+	computer.capability.ipc = 60;
+	computer.capability.ipcResumable = true;
+	CHECK(computer.LoadProgram(lines));
+	computer.RunInit();
+
+	// An input received while the tick is suspended runs once it completes, without clobbering the locals of @sum
+	computer.RunCycle();
+	CHECK(computer.IsSuspended());
+	try {
+		computer.RunInput(0, {3.0});
+	} catch (const std::exception& e) {
+		cout << "RunInput while suspended: " << e.what() << endl;
+		++failures;
+	}
+	CHECK(outputs.empty());
+	try {
+		for (int cycles = 0; outputs.size() < 3 && cycles < 100; ++cycles) {
+			computer.RunCycle();
+		}
+	} catch (const std::exception& e) {
+		cout << "RunCycle: " << e.what() << endl;
+		++failures;
+	}
+	
+	// The entry point called by trigger() cannot be suspended, it gets a budget of its own instead of what the tick left
+	CHECK((outputs.size() >= 3 && vector<string>(outputs.begin(), outputs.begin() + 3) == vector<string>{"0:1225", "2:36", "1:3"}));
+	
+	// Without ipcResumable, exceeding the budget is still an error
+	Computer strict(context);
+	strict.capability.ipc = 60;
+	CHECK(strict.LoadProgram(lines));
+	strict.RunInit();
+	bool thrown = false;
+	try {
+		strict.RunCycle();
+	} catch (const RuntimeError&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+void TestSuspendedState() {
+	DeviceContext context;
+	vector<string> outputs;
+	CaptureOutputs(context, outputs);
+	auto lines = GetLines(R"(
+var $label = ""
+recursive function @sum_to($n:number):number
+	var $s = 0
+	repeat 3 ($i)
+		$s += $i
+	if $n < 1
+		return $s
+	return $s + $n + recurse($n - 1)
+tick
+	output.0 (@sum_to(8))
+input.0 ($text:text)
+	$label = $text
+	output.1 ($label)
+)", context);
+	Computer computer(context);
+	computer.capability.ipc = 40;
+	computer.capability.ipcResumable = true;
+	CHECK(computer.LoadProgram(lines));
+	computer.RunInit();
+	
+	// Saved while suspended within the recursion, along with an input received in the meantime
+	computer.RunCycle();
+	computer.RunCycle();
+	CHECK(computer.IsSuspended());
+	computer.RunInput(0, {"a text too long to be stored inline"});
+	auto state = computer.SaveState();
+	Computer restored(context);
+	restored.capability = computer.capability;
+	CHECK(restored.LoadState(state));
+	CHECK(restored.IsSuspended());
+	
+	// Both carry on the same way
+	auto run = [&outputs](Computer& computer) {
+		outputs.clear();
+		for (int cycles = 0; cycles < 20; ++cycles) {
+			computer.RunCycle();
+		}
+		return outputs;
+	};
+	auto expected = run(computer);
+	CHECK((expected.size() >= 3 && expected[0] == "0:63" && expected[1] == "1:a text too long to be stored inline" && expected[2] == "0:63"));
+	CHECK(run(restored) == expected);
+}
+
+void TestInlinedErrors() {
+	DeviceContext context;
+	vector<string> outputs;
+	CaptureOutputs(context, outputs);
+	auto lines = GetLines(R"(function @inverse($x:number):number
+	return 1 / $x
+function @half_inverse($x:number):number
+	return @inverse($x) / 2
+init
+	var $zero = 0
+	output.0 (@half_inverse($zero))
+)", context);
+	
+	// An error within inlined functions still reports where they were called from
+	string errors[3];
+	for (int level : {0, 1, 2}) {
+		Computer computer(context);
+		CHECK(computer.LoadProgram(Compile(lines, context, level)));
+		try {
+			computer.RunInit();
+		} catch (const RuntimeError& e) {
+			errors[level] = regex_replace(e.what(), regex("bytecode [0-9]+"), "bytecode");
+		}
+	}
+	CHECK(errors[0].find("main.xc:2\n") != string::npos && errors[0].find("main.xc:4\n") != string::npos && errors[0].find("main.xc:7\n") != string::npos);
+	CHECK(errors[1] == errors[0]);
+	CHECK(errors[2] == errors[0]);
+}
+
+void TestComputerPool() {
+	DeviceContext context;
+	mutex outputsMutex;
+	map<const Computer*, vector<string>> outputs;
+	context.SetOutputFunction([&](Computer* computer, uint32_t port, const vector<Var>& args){
+		lock_guard lock(outputsMutex);
+		outputs[computer].push_back(to_string(port) + ":" + string(args[0]));
+	});
+	auto lines = GetLines(R"(var $ticks = 0
+array $values:number
+input.0 ($v:number)
+	output.1 ($v + $ticks)
+tick
+	$ticks++
+	$values.clear()
+	repeat 100 ($i)
+		$values.append(100 - $i)
+	$values.sort()
+	output.0 ($ticks + $values.0)
+)", context);
+	auto assembly = Compile(lines, context, 1);
+	vector<unique_ptr<Computer>> computers;
+	ComputerPool pool(4);
+	CHECK(pool.GetThreadCount() == 4);
+	for (int i = 0; i < 64; ++i) {
+		auto& computer = computers.emplace_back(make_unique<Computer>(context));
+		computer->capability.ipc = (i == 5)? 10 : 100000;
+		CHECK(computer->LoadProgram(assembly));
+		computer->RunInit();
+		pool.Add(computer.get());
+	}
+	for (int cycle = 0; cycle < 10; ++cycle) {
+		pool.QueueInput(computers[3].get(), 0, {100.0});
+		pool.RunCycle();
+	}
+	
+	// Each computer runs its cycles in order, followed by the inputs queued for it
+	vector<string> expected, expectedWithInputs;
+	for (int tick = 1; tick <= 10; ++tick) {
+		expected.push_back("0:" + to_string(tick + 1));
+		expectedWithInputs.push_back("0:" + to_string(tick + 1));
+		expectedWithInputs.push_back("1:" + to_string(tick + 100));
+	}
+	for (int i = 0; i < 64; ++i) {
+		if (i == 5) continue;
+		CHECK(outputs[computers[i].get()] == (i == 3? expectedWithInputs : expected));
+		CHECK(pool.GetStats(computers[i].get()).cycles == 10 && pool.GetStats(computers[i].get()).error == "");
+	}
+	
+	// A computer that crashed is not run anymore, without affecting the others
+	CHECK(outputs[computers[5].get()].empty());
+	CHECK(pool.GetStats(computers[5].get()).cycles == 1 && pool.GetStats(computers[5].get()).error.starts_with("Maximum IPC exceeded"));
+	
+	// Removed computers are not run
+	pool.Remove(computers[0].get());
+	pool.RunCycle();
+	CHECK(outputs[computers[0].get()].size() == 10 && outputs[computers[1].get()].size() == 11);
+}
+
+void TestAssemblyCache() {
+	DeviceContext context, other;
+	vector<string> outputs;
+	CaptureOutputs(context, outputs);
+	auto lines = GetLines(R"(var $x = 1
+tick
+	$x++
+	output.0 ($x)
+)", context);
+	stringstream program;
+	CHECK(Computer::CompileAssembly(program, lines, false, context));
+	auto& cache = GetSharedAssemblyCache();
+	size_t size = cache.Size();
+	{
+		// Computers loading the same compiled program share its assembly, but not their memory
+		Computer a(context), b(context), c(other);
+		istringstream programA(program.str()), programB(program.str()), programC(program.str());
+		CHECK(a.LoadProgram(programA));
+		CHECK(b.LoadProgram(programB));
+		CHECK(a.GetAssembly() == b.GetAssembly());
+		CHECK(cache.Size() == size + 1);
+		a.RunInit();
+		b.RunInit();
+		a.RunCycle();
+		a.RunCycle();
+		b.RunCycle();
+		CHECK((outputs == vector<string>{"0:2", "0:3", "0:2"}));
+		
+		// Not across contexts
+		CHECK(c.LoadProgram(programC));
+		CHECK(c.GetAssembly() != a.GetAssembly());
+		CHECK(cache.Size() == size + 2);
+		
+		// Nor with a computer of another context
+		Computer d(other);
+		CHECK(!d.LoadProgram(a.GetAssembly()));
+		
+		// A saved state loads the same assembly again
+		Computer e(context);
+		CHECK(e.LoadState(a.SaveState()));
+		CHECK(e.GetAssembly() == a.GetAssembly());
+		e.RunCycle();
+		CHECK(outputs.back() == "0:4");
+	}
+	
+	// Released along with the last computer using it
+	CHECK(cache.Size() == size);
+}
+
+void TestCompileCache() {
+	DeviceContext context, other;
+	other.DeclareGlobalConstant("k", 1);
+	const string source = R"(const $half = 0.5
+var $x = 1
+init
+	$x = $half * 4
+)";
+	auto lines = GetLines(source, context);
+	CompileCache cache;
+	
+	// Compiled once per source, context and optimization level
+	auto program = cache.Compile(lines, false, context, 0);
+	CHECK(cache.Compile(lines, false, context, 0) == program);
+	auto optimized = cache.Compile(lines, false, context, 2);
+	CHECK(optimized != program && *optimized != *program);
+	CHECK(cache.Compile(lines, false, context, 2) == optimized);
+	CHECK(cache.Compile(lines, false, other, 0) != program);
+	CHECK(cache.Size() == 3);
+	stringstream compiled;
+	CHECK(Computer::CompileAssembly(compiled, lines, false, context, 2));
+	CHECK(compiled.str() == *optimized);
+	
+	// A change to the source is compiled again
+	auto changed = cache.Compile(GetLines(source + "\t$x++\n", context), false, context, 0);
+	CHECK(changed != program && *changed != *program);
+	CHECK(cache.Compile(lines, false, context, 0) == program);
+	
+	// Verbose compilations always run the compiler
+	auto verbose = cout.rdbuf(nullptr);
+	auto recompiled = cache.Compile(lines, true, context, 0);
+	cout.rdbuf(verbose);
+	CHECK(recompiled != program && *recompiled == *program);
+	
+	// Compiled programs are read back from the directory once forgotten
+	string directory = (filesystem::temp_directory_path() / "xenoncode_harness_cache").string();
+	filesystem::remove_all(directory);
+	cache.SetDirectory(directory);
+	cache.Clear();
+	program = cache.Compile(lines, false, context, 0);
+	optimized = cache.Compile(lines, false, context, 2);
+	CHECK(distance(filesystem::directory_iterator(directory), filesystem::directory_iterator()) == 2);
+	cache.Clear();
+	CHECK(cache.Size() == 0);
+	auto read = cache.Compile(lines, false, context, 2);
+	CHECK(read != optimized && *read == *optimized);
+	CHECK(*cache.Compile(lines, false, context, 0) == *program);
+	filesystem::remove_all(directory);
+}
+
+void TestCompileSession() {
+	string directory = WriteFiles("xenoncode_harness_session", {
+		{"main.xc", "include \"a.xc\"\ninit\n\t@a()\n"},
+		{"a.xc", "include \"b.xc\"\nfunction @a()\n\t@b()\n"},
+		{"b.xc", "function @b()\n\toutput.0 (\"b\")\n"},
+	});
+	CompileSession session;
+	auto parsed = session.GetParsedFile(directory, "main.xc");
+	CHECK(SameLines(parsed.lines, GetParsedFile(directory, "main.xc").lines));
+	CHECK(session.Size() == 3);
+	
+	// Changed files are parsed again
+	ofstream(directory + "/b.xc") << "function @b()\n\toutput.0 (\"changed\")\n";
+	auto changed = session.GetParsedFile(directory, "main.xc");
+	CHECK(!SameLines(changed.lines, parsed.lines));
+	CHECK(SameLines(changed.lines, GetParsedFile(directory, "main.xc").lines));
+	CHECK(SameLines(changed.lines, session.GetParsedFile(directory, "main.xc").lines));
+	
+	// Files that are not included anymore are forgotten
+	ofstream(directory + "/a.xc") << "function @a()\n\toutput.0 (\"a\")\n";
+	parsed = session.GetParsedFile(directory, "main.xc");
+	CHECK(SameLines(parsed.lines, GetParsedFile(directory, "main.xc").lines));
+	CHECK(session.Size() == 2);
+	
+	// Errors are reported until the file is fixed
+	ofstream(directory + "/a.xc") << "function @a()\n\toutput.0 (\"a\"\n";
+	bool thrown = false;
+	try {
+		session.GetParsedFile(directory, "main.xc");
+	} catch (const ParseError&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	ofstream(directory + "/a.xc") << "function @a()\n\toutput.0 (\"fixed\")\n";
+	CHECK(SameLines(session.GetParsedFile(directory, "main.xc").lines, GetParsedFile(directory, "main.xc").lines));
+	filesystem::remove_all(directory);
+}
+
+void TestParallelParsing() {
+	string big = "var $big = 0\n";
+	for (int i = 0; i < 3000; ++i) {
+		big += "function @f" + to_string(i) + "($x:number):number\n\treturn $x + " + to_string(i) + "\n";
+	}
+	map<string, string> files {
+		{"main.xc", "include \"a.xc\"\ninclude \"b.xc\"\ninit\n\toutput.0 (@a() + @f2999($big))\n"},
+		{"a.xc", "include \"a1.xc\"\ninclude \"a2.xc\"\nfunction @a():number\n\treturn @a1() + @a2()\n"},
+		{"a1.xc", "function @a1():number\n\treturn 1\n"},
+		{"a2.xc", "function @a2():number\n\treturn 2\n"},
+		{"b.xc", "include \"big.xc\"\n"},
+		{"big.xc", big},
+	};
+	string directory = WriteFiles("xenoncode_harness_parallel", files);
+	
+	// The same lines as when parsing the files one after the other, in the order they are included
+	auto parseSequentially = [&]{
+		vector<ParsedLine> lines;
+		set<string> parsedFiles;
+		AppendParsedFile(directory, "main.xc", parsedFiles, lines, [](const string& dir, const string& name){
+			return make_shared<const SourceFile>(dir, name);
+		});
+		return lines;
+	};
+	auto expected = parseSequentially();
+	for (int i = 0; i < 20; ++i) {
+		CHECK(SameLines(GetParsedFile(directory, "main.xc").lines, expected));
+	}
+	
+	// The first error in that order is reported
+	auto getError = [&](auto&& parse){
+		try {
+			parse();
+		} catch (const ParseError& e) {
+			return string(e.what());
+		}
+		return string();
+	};
+	ofstream(directory + "/a2.xc") << "function @a2():number\n\treturn (2\n";
+	ofstream(directory + "/big.xc") << big << "function @g(\n" << big << "function @h(\n";
+	string error = getError(parseSequentially);
+	CHECK(error.find("a2.xc") != string::npos);
+	for (int i = 0; i < 20; ++i) {
+		CHECK(getError([&]{ GetParsedFile(directory, "main.xc"); }) == error);
+	}
+	ofstream(directory + "/a2.xc") << files["a2.xc"];
+	error = getError(parseSequentially);
+	CHECK(error.find("big.xc") != string::npos);
+	for (int i = 0; i < 20; ++i) {
+		CHECK(getError([&]{ GetParsedFile(directory, "main.xc"); }) == error);
+	}
+	
+	// Every parsing thread is released, errors included
+	CHECK(ParsingThreads::Running() == 0);
+	filesystem::remove_all(directory);
+}
+
+int main() {
+	TestDeviceFunctionOverride();
+	TestResumableIpc();
+	TestSuspendedState();
+	TestInlinedErrors();
+	TestComputerPool();
+	TestAssemblyCache();
+	TestCompileCache();
+	TestCompileSession();
+	TestParallelParsing();
+	if (failures) {
+		cout << failures << " failed" << endl;
+		return 1;
+	}
+	cout << "OK" << endl;
+	return 0;
+}